@@ -0,0 +1,80 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/glew.h>
+#include "context.h"
+
+int bench_create_context(int width, int height) {
+
+	EGLDisplay display;
+	EGLConfig config;
+	EGLSurface surface;
+	EGLContext context;
+	EGLint major, minor, num_configs;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+
+	EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+
+	EGLint pbuffer_attribs[] = {
+		EGL_WIDTH, width,
+		EGL_HEIGHT, height,
+		EGL_NONE
+	};
+
+	display = EGL_NO_DISPLAY;
+	get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if(get_platform_display) {
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if(display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	if(!eglInitialize(display, &major, &minor)) {
+		fprintf(stderr, "Could not initialize EGL\n");
+		return -1;
+	}
+
+	eglChooseConfig(display, config_attribs, &config, 1, &num_configs);
+	if(num_configs == 0) {
+		fprintf(stderr, "No EGL config with desktop GL support\n");
+		return -1;
+	}
+
+	eglBindAPI(EGL_OPENGL_API);
+	surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+	if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+		fprintf(stderr, "Could not create EGL context\n");
+		return -1;
+	}
+
+	glewExperimental = GL_TRUE;
+	glewInit();
+
+	fprintf(stderr, "Renderer: %s\n", glGetString(GL_RENDERER));
+	return 0;
+
+}
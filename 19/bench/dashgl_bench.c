@@ -0,0 +1,1053 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks for every public function in lib/dashgl.
+ *
+ * Results are written one case per line as tab separated values:
+ *
+ *     name	iterations	ns_per_op	ops_per_sec
+ *
+ * Given a baseline file in the same format (-b), any case whose ns/op
+ * grew by more than the threshold percentage (-t, default 10) is
+ * reported on stderr and the program exits with status 1.
+ *
+ * Shader and texture cases need a GL context, which is created headless
+ * through EGL by bench/context.c so the benchmark runs without a
+ * display server.
+ */
+
+#include <png.h>
+#include <time.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+#include "context.h"
+
+// The GL cases only need a context, so the pbuffer stays small
+#define WIDTH 64
+#define HEIGHT 64
+#define MAX_BASELINE 256
+
+struct bench_case {
+	const char *name;
+	void (*run)(long iterations);
+	int needs_gl;
+};
+
+struct {
+	char name[MAX_BASELINE][64];
+	double ns_per_op[MAX_BASELINE];
+	int count;
+} baseline;
+
+static volatile float sink;
+static FILE *results;
+static FILE *output;
+static const char *vertex_source = "#version 130\n"
+	"attribute vec2 coord2d;\n"
+	"uniform mat4 ortho, mvp;\n"
+	"void main(void) {\n"
+	"\tgl_Position = ortho * mvp * vec4(coord2d, 0.0, 1.0);\n"
+	"}\n";
+static const char *fragment_source = "#version 130\n"
+	"uniform vec3 diffuse;\n"
+	"void main(void) {\n"
+	"\tgl_FragColor = vec4(diffuse, 1.0);\n"
+	"}\n";
+static char vertex_path[] = "/tmp/dashgl_bench_vs_XXXXXX";
+static char fragment_path[] = "/tmp/dashgl_bench_fs_XXXXXX";
+static char texture_path[] = "/tmp/dashgl_bench_png_XXXXXX";
+static char atlas_path[] = "/tmp/dashgl_bench_atlas_XXXXXX";
+static char dtx_path[] = "/tmp/dashgl_bench_dtx_XXXXXX";
+
+/******************************************************************************/
+/** Timing                                                                   **/
+/******************************************************************************/
+
+static double now_ns() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}
+
+static int compare_double(const void *a, const void *b) {
+
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+
+}
+
+/******************************************************************************/
+/** Vector3 Cases                                                            **/
+/******************************************************************************/
+
+static void bench_vec3_subtract(long n) {
+
+	vec3 a = { 1.0f, 2.0f, 3.0f };
+	vec3 b = { 0.5f, 0.25f, 0.125f };
+	vec3 v;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		vec3_subtract(a, b, v);
+		a[0] = v[1];
+	}
+	sink = v[0];
+
+}
+
+static void bench_vec3_cross_multiply(long n) {
+
+	vec3 a = { 1.0f, 2.0f, 3.0f };
+	vec3 b = { 0.5f, 0.25f, 0.125f };
+	vec3 v;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		vec3_cross_multiply(a, b, v);
+		a[0] = v[1] * 0.5f;
+	}
+	sink = v[0];
+
+}
+
+static void bench_vec3_normalize(long n) {
+
+	vec3 a = { 1.0f, 2.0f, 3.0f };
+	vec3 v;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		vec3_normalize(a, v);
+		a[0] = v[1] + 1.0f;
+	}
+	sink = v[0];
+
+}
+
+/******************************************************************************/
+/** Matrix Cases                                                             **/
+/******************************************************************************/
+
+static void bench_mat4_identity(long n) {
+
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_identity(m);
+	}
+	sink = m[M_33];
+
+}
+
+static void bench_mat4_copy(long n) {
+
+	mat4 a, m;
+	long i;
+
+	mat4_identity(a);
+	for(i = 0; i < n; i++) {
+		mat4_copy(a, m);
+		a[M_03] = m[M_00];
+	}
+	sink = m[M_03];
+
+}
+
+static void bench_mat4_translate(long n) {
+
+	vec3 t = { 1.0f, 2.0f, 3.0f };
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_translate(t, m);
+		t[0] = m[M_13];
+	}
+	sink = m[M_03];
+
+}
+
+static void bench_mat4_rotate_x(long n) {
+
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_rotate_x((float)i * 0.001f, m);
+	}
+	sink = m[M_11];
+
+}
+
+static void bench_mat4_rotate_y(long n) {
+
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_rotate_y((float)i * 0.001f, m);
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_rotate_z(long n) {
+
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_rotate_z((float)i * 0.001f, m);
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_multiply(long n) {
+
+	mat4 a, b, m;
+	long i;
+
+	mat4_rotate_z(0.5f, a);
+	mat4_rotate_x(0.25f, b);
+	for(i = 0; i < n; i++) {
+		mat4_multiply(a, b, m);
+		a[M_03] = m[M_01];
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_rotate(long n) {
+
+	vec3 r = { 0.1f, 0.2f, 0.3f };
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_rotate(r, m);
+		r[0] = m[M_01];
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_look_at(long n) {
+
+	vec3 eye = { 0.0f, 2.0f, 5.0f };
+	vec3 center = { 0.0f, 0.0f, 0.0f };
+	vec3 up = { 0.0f, 1.0f, 0.0f };
+	mat4 m;
+	long i;
+
+	mat4_identity(m);
+	for(i = 0; i < n; i++) {
+		mat4_look_at(eye, center, up, m);
+		center[0] = m[M_00] * 0.001f;
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_perspective(long n) {
+
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_perspective(0.8f + (float)(i & 7) * 0.01f, 1.333f, 0.1f, 100.0f, m);
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_orthographic(long n) {
+
+	mat4 m;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		mat4_orthographic(0.0f, 640.0f + (float)(i & 7), 480.0f, 0.0f, m);
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_transpose(long n) {
+
+	mat4 a, m;
+	long i;
+
+	mat4_rotate_z(0.5f, a);
+	for(i = 0; i < n; i++) {
+		mat4_transpose(a, m);
+		a[M_03] = m[M_01];
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_inverse(long n) {
+
+	vec3 t = { 1.0f, 2.0f, 3.0f };
+	mat4 a, b, m;
+	long i;
+
+	mat4_perspective(0.8f, 1.333f, 0.1f, 100.0f, a);
+	mat4_translate(t, b);
+	mat4_multiply(a, b, a);
+	for(i = 0; i < n; i++) {
+		mat4_inverse(a, m);
+		a[M_03] = m[M_01] + 1.0f;
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_inverse_affine(long n) {
+
+	vec3 r = { 0.1f, 0.2f, 0.3f };
+	mat4 a, m;
+	long i;
+
+	mat4_rotate(r, a);
+	for(i = 0; i < n; i++) {
+		mat4_inverse_affine(a, m);
+		a[M_03] = m[M_01];
+	}
+	sink = m[M_00];
+
+}
+
+static void bench_mat4_normal(long n) {
+
+	vec3 r = { 0.1f, 0.2f, 0.3f };
+	mat4 a, m;
+	long i;
+
+	mat4_rotate(r, a);
+	for(i = 0; i < n; i++) {
+		mat4_normal(a, m);
+		a[M_00] = m[M_11] + 0.5f;
+	}
+	sink = m[M_00];
+
+}
+
+/******************************************************************************/
+/** Shader and Texture Cases                                                 **/
+/******************************************************************************/
+
+static int write_file(char *path, const char *text) {
+
+	int fd;
+	size_t len;
+
+	fd = mkstemp(path);
+	if(fd == -1) {
+		fprintf(stderr, "Could not create %s\n", path);
+		return -1;
+	}
+
+	len = strlen(text);
+	if(write(fd, text, len) != (ssize_t)len) {
+		fprintf(stderr, "Could not write %s\n", path);
+		close(fd);
+		return -1;
+	}
+
+	close(fd);
+	return 0;
+
+}
+
+static int write_atlas(char *path, const char *page) {
+
+	char text[8192];
+	int len, i;
+
+	// 64 sprites of 30x14 on the benchmark texture, as tools/atlas
+	// would write them
+	len = snprintf(text, sizeof(text), "dashgl-atlas 1\npage 0 %s 256 256\n", strrchr(page, '/') + 1);
+	len += snprintf(text + len, sizeof(text) - len, "sprite ball 0 0 240 16 16\n");
+	for(i = 0; i < 64; i++) {
+		len += snprintf(text + len, sizeof(text) - len, "sprite brick_%d 0 %d %d 30 14\n",
+			i, (i % 8) * 32 + 1, (i / 8) * 16 + 1);
+	}
+	snprintf(text + len, sizeof(text) - len, "sprite paddle 0 16 240 120 16\n");
+
+	return write_file(path, text);
+
+}
+
+static int write_dtx(char *path, int size) {
+
+	struct dash_dtx_header header;
+	unsigned char *pixels;
+	unsigned int offset;
+	int fd, i, w;
+
+	// Same layout tools/texconv writes: RGBA with a full mip chain
+	memset(&header, 0, sizeof(header));
+	header.magic = DASH_DTX_MAGIC;
+	header.format = GL_RGBA;
+	header.width = size;
+	header.height = size;
+
+	offset = (sizeof(header) + 15) & ~15u;
+	for(w = size, i = 0; w >= 1 && i < DASH_DTX_MAX_LEVELS; w /= 2, i++) {
+		header.level[i].offset = offset;
+		header.level[i].size = w * w * 4;
+		header.level[i].width = w;
+		header.level[i].height = w;
+		header.num_levels = i + 1;
+		offset = (offset + header.level[i].size + 15) & ~15u;
+	}
+
+	fd = mkstemp(path);
+	if(fd == -1) {
+		fprintf(stderr, "Could not create %s\n", path);
+		return -1;
+	}
+
+	pixels = (unsigned char*)calloc(1, offset);
+	memcpy(pixels, &header, sizeof(header));
+	for(i = sizeof(header); i < (int)offset; i++) {
+		pixels[i] = i * 7;
+	}
+	if(write(fd, pixels, offset) != (ssize_t)offset) {
+		fprintf(stderr, "Could not write %s\n", path);
+	}
+	free(pixels);
+	close(fd);
+	return 0;
+
+}
+
+static int write_texture(char *path, int width, int height) {
+
+	FILE *fp;
+	int fd, y, x;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	png_bytep row;
+
+	fd = mkstemp(path);
+	if(fd == -1) {
+		fprintf(stderr, "Could not create %s\n", path);
+		return -1;
+	}
+	fp = fdopen(fd, "wb");
+
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	info_ptr = png_create_info_struct(png_ptr);
+	if(setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		fclose(fp);
+		return -1;
+	}
+
+	png_init_io(png_ptr, fp);
+	png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGBA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+
+	row = (png_bytep)malloc(width * 4);
+	for(y = 0; y < height; y++) {
+		for(x = 0; x < width; x++) {
+			row[x*4 + 0] = x ^ y;
+			row[x*4 + 1] = x * 3;
+			row[x*4 + 2] = y * 5;
+			row[x*4 + 3] = 255;
+		}
+		png_write_row(png_ptr, row);
+	}
+	free(row);
+
+	png_write_end(png_ptr, NULL);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	fclose(fp);
+	return 0;
+
+}
+
+static void bench_dash_create_shader(long n) {
+
+	GLuint shader;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		shader = dash_create_shader(vertex_path, GL_VERTEX_SHADER);
+		glDeleteShader(shader);
+	}
+
+}
+
+static void bench_dash_print_log(long n) {
+
+	GLuint shader;
+	int saved, null_fd;
+	long i;
+
+	shader = dash_create_shader(fragment_path, GL_FRAGMENT_SHADER);
+
+	fflush(stderr);
+	saved = dup(2);
+	null_fd = open("/dev/null", O_WRONLY);
+	dup2(null_fd, 2);
+
+	for(i = 0; i < n; i++) {
+		dash_print_log(shader);
+	}
+
+	fflush(stderr);
+	dup2(saved, 2);
+	close(saved);
+	close(null_fd);
+	glDeleteShader(shader);
+
+}
+
+static void bench_dash_create_program(long n) {
+
+	GLuint program;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		program = dash_create_program(vertex_path, fragment_path);
+		glDeleteProgram(program);
+	}
+
+}
+
+static void bench_dash_create_program_source(long n) {
+
+	GLuint program;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		program = dash_create_program_source(vertex_source, fragment_source);
+		glDeleteProgram(program);
+	}
+
+}
+
+static void bench_dash_create_program_async(long n) {
+
+	dash_program_job *job;
+	GLuint program;
+	long i;
+
+	// Start and poll to completion, the latency an application sees
+	// from the async path when it polls every frame
+	for(i = 0; i < n; i++) {
+		job = dash_create_program_source_async(vertex_source, fragment_source);
+		while(dash_program_poll(job, &program) == 0);
+		glDeleteProgram(program);
+	}
+
+}
+
+static void bench_dash_program_cancel(long n) {
+
+	long i;
+
+	for(i = 0; i < n; i++) {
+		dash_program_cancel(dash_create_program_async(vertex_path, fragment_path));
+	}
+	glFinish();
+
+}
+
+static void bench_dash_watch_changed(long n) {
+
+	char *vs_source, *fs_source;
+	long i;
+
+	// Nothing is written to the watched files, so this is the cost of
+	// the per-frame poll when no reload is pending
+	for(i = 0; i < n; i++) {
+		if(dash_watch_changed(&vs_source, &fs_source)) {
+			free(vs_source);
+			free(fs_source);
+		}
+	}
+
+}
+
+static void bench_dash_png_read(long n) {
+
+	unsigned char *data;
+	int width, height;
+	GLenum format;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		data = dash_png_read(texture_path, &width, &height, &format);
+		free(data);
+	}
+
+}
+
+static void bench_dash_texture_load(long n) {
+
+	GLuint texture;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		texture = dash_texture_load(texture_path);
+		glDeleteTextures(1, &texture);
+	}
+	glFinish();
+
+}
+
+static void bench_dash_texture_load_dtx(long n) {
+
+	GLuint texture;
+	long i;
+
+	for(i = 0; i < n; i++) {
+		texture = dash_texture_load_dtx(dtx_path);
+		glDeleteTextures(1, &texture);
+	}
+	glFinish();
+
+}
+
+static void bench_dash_stream_texture(long n) {
+
+	GLuint texture;
+	long i;
+
+	// Queue, decode on a worker and upload through the PBO path with no
+	// frame budget, i.e. the streaming overhead on top of a plain load
+	dash_stream_budget(1000.0);
+	for(i = 0; i < n; i++) {
+		texture = dash_stream_texture(texture_path);
+		while(dash_stream_update() > 0);
+		glDeleteTextures(1, &texture);
+	}
+	glFinish();
+
+}
+
+static void bench_dash_atlas_load(long n) {
+
+	long i;
+
+	for(i = 0; i < n; i++) {
+		dash_atlas_free(dash_atlas_load(atlas_path));
+	}
+	glFinish();
+
+}
+
+static void bench_dash_atlas_lookup(long n) {
+
+	static const char *names[] = { "brick_0", "brick_31", "paddle", "ball", "missing" };
+	dash_atlas *atlas;
+	dash_uv_rect rect;
+	long i;
+
+	atlas = dash_atlas_load(atlas_path);
+	for(i = 0; i < n; i++) {
+		dash_atlas_lookup(atlas, names[i % 5], &rect);
+	}
+	sink = rect.u0;
+	dash_atlas_free(atlas);
+
+}
+
+static void bench_dash_hud_draw(long n) {
+
+	long i;
+
+	// Build and submit the whole overlay, one batched draw per frame
+	for(i = 0; i < n; i++) {
+		dash_hud_frame(16.7f + (i % 7), 1, 32, 0.5f);
+		dash_hud_draw(640.0f, 480.0f);
+	}
+	glFinish();
+
+}
+
+static void bench_dash_gl_stats_frame(long n) {
+
+	long i;
+
+	for(i = 0; i < n; i++) {
+		dash_gl_stats_frame();
+	}
+	sink = dash_gl_stats_last()->total;
+
+}
+
+static void bench_dash_state_cache(long n) {
+
+	static const float white[3] = { 1.0f, 1.0f, 1.0f };
+	GLuint program, vbo;
+	GLint mvp, diffuse;
+	mat4 m;
+	long i;
+
+	program = dash_create_program_source(vertex_source, fragment_source);
+	mvp = glGetUniformLocation(program, "mvp");
+	diffuse = glGetUniformLocation(program, "diffuse");
+	glGenBuffers(1, &vbo);
+	mat4_identity(m);
+	dash_state_reset();
+
+	// A frame's worth of state setup where nothing changed, so every
+	// call after the first should be dropped by the cache
+	for(i = 0; i < n; i++) {
+		dash_use_program(program);
+		dash_bind_buffer(GL_ARRAY_BUFFER, vbo);
+		dash_enable_attrib(0);
+		dash_attrib_pointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+		dash_uniform_matrix4fv(mvp, m);
+		dash_uniform3fv(diffuse, white);
+	}
+
+	dash_use_program(0);
+	glDeleteBuffers(1, &vbo);
+	glDeleteProgram(program);
+	dash_state_reset();
+
+}
+
+static void bench_dash_resource_track(long n) {
+
+	long i;
+
+	// Track and release with a hundred other objects live, roughly what
+	// the game keeps registered
+	for(i = 1; i <= 100; i++) {
+		dash_resource_track(DASH_RESOURCE_MEMORY, i, 64, "bench");
+	}
+	for(i = 0; i < n; i++) {
+		dash_resource_track(DASH_RESOURCE_BUFFER, 1000 + (i & 7), 4096, "bench");
+		dash_resource_untrack(DASH_RESOURCE_BUFFER, 1000 + (i & 7));
+	}
+	for(i = 1; i <= 100; i++) {
+		dash_resource_untrack(DASH_RESOURCE_MEMORY, i);
+	}
+
+}
+
+static struct bench_case cases[] = {
+	{ "vec3_subtract", bench_vec3_subtract, 0 },
+	{ "vec3_cross_multiply", bench_vec3_cross_multiply, 0 },
+	{ "vec3_normalize", bench_vec3_normalize, 0 },
+	{ "mat4_identity", bench_mat4_identity, 0 },
+	{ "mat4_copy", bench_mat4_copy, 0 },
+	{ "mat4_translate", bench_mat4_translate, 0 },
+	{ "mat4_rotate_x", bench_mat4_rotate_x, 0 },
+	{ "mat4_rotate_y", bench_mat4_rotate_y, 0 },
+	{ "mat4_rotate_z", bench_mat4_rotate_z, 0 },
+	{ "mat4_multiply", bench_mat4_multiply, 0 },
+	{ "mat4_rotate", bench_mat4_rotate, 0 },
+	{ "mat4_look_at", bench_mat4_look_at, 0 },
+	{ "mat4_perspective", bench_mat4_perspective, 0 },
+	{ "mat4_orthographic", bench_mat4_orthographic, 0 },
+	{ "mat4_transpose", bench_mat4_transpose, 0 },
+	{ "mat4_inverse", bench_mat4_inverse, 0 },
+	{ "mat4_inverse_affine", bench_mat4_inverse_affine, 0 },
+	{ "mat4_normal", bench_mat4_normal, 0 },
+	{ "dash_gl_stats_frame", bench_dash_gl_stats_frame, 0 },
+	{ "dash_resource_track", bench_dash_resource_track, 0 },
+	{ "dash_create_shader", bench_dash_create_shader, 1 },
+	{ "dash_print_log", bench_dash_print_log, 1 },
+	{ "dash_create_program", bench_dash_create_program, 1 },
+	{ "dash_create_program_source", bench_dash_create_program_source, 1 },
+	{ "dash_create_program_async", bench_dash_create_program_async, 1 },
+	{ "dash_program_cancel", bench_dash_program_cancel, 1 },
+	{ "dash_watch_changed", bench_dash_watch_changed, 1 },
+	{ "dash_state_cache", bench_dash_state_cache, 1 },
+	{ "dash_png_read", bench_dash_png_read, 1 },
+	{ "dash_texture_load", bench_dash_texture_load, 1 },
+	{ "dash_texture_load_dtx", bench_dash_texture_load_dtx, 1 },
+	{ "dash_stream_texture", bench_dash_stream_texture, 1 },
+	{ "dash_atlas_load", bench_dash_atlas_load, 1 },
+	{ "dash_atlas_lookup", bench_dash_atlas_lookup, 1 },
+	{ "dash_hud_draw", bench_dash_hud_draw, 1 },
+	{ NULL, NULL, 0 }
+};
+
+/******************************************************************************/
+/** Baseline                                                                 **/
+/******************************************************************************/
+
+static int load_baseline(const char *filename) {
+
+	FILE *fp;
+	char line[256];
+	long iterations;
+	double ops;
+
+	fp = fopen(filename, "r");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return -1;
+	}
+
+	while(fgets(line, sizeof(line), fp) && baseline.count < MAX_BASELINE) {
+		if(line[0] == '#') {
+			continue;
+		}
+		if(sscanf(line, "%63s %ld %lf %lf",
+			baseline.name[baseline.count], &iterations,
+			&baseline.ns_per_op[baseline.count], &ops) == 4) {
+			baseline.count++;
+		}
+	}
+
+	fclose(fp);
+	return 0;
+
+}
+
+static double baseline_lookup(const char *name) {
+
+	int i;
+
+	for(i = 0; i < baseline.count; i++) {
+		if(strcmp(baseline.name[i], name) == 0) {
+			return baseline.ns_per_op[i];
+		}
+	}
+	return 0.0;
+
+}
+
+/******************************************************************************/
+/** Runner                                                                   **/
+/******************************************************************************/
+
+static double measure(struct bench_case *c, double min_ns, int repeat, long *iterations) {
+
+	double start, elapsed, samples[32];
+	long n;
+	int i;
+
+	n = 1;
+	for(;;) {
+		start = now_ns();
+		c->run(n);
+		elapsed = now_ns() - start;
+		if(elapsed >= min_ns || n >= (1L << 40)) {
+			break;
+		}
+		if(elapsed < min_ns / 100.0) {
+			n *= 10;
+		} else {
+			n = (long)(n * (min_ns * 1.2 / elapsed)) + 1;
+		}
+	}
+
+	samples[0] = elapsed / n;
+	for(i = 1; i < repeat; i++) {
+		start = now_ns();
+		c->run(n);
+		samples[i] = (now_ns() - start) / n;
+	}
+
+	qsort(samples, repeat, sizeof(double), compare_double);
+	*iterations = n;
+	return samples[repeat / 2];
+
+}
+
+static void report(const char *format, ...) {
+
+	va_list args;
+
+	va_start(args, format);
+	vfprintf(results, format, args);
+	va_end(args);
+	fflush(results);
+
+	if(output) {
+		va_start(args, format);
+		vfprintf(output, format, args);
+		va_end(args);
+	}
+
+}
+
+static void usage(const char *argv0) {
+
+	fprintf(stderr, "Usage: %s [-b baseline.tsv] [-t percent] [-o out.tsv]\n", argv0);
+	fprintf(stderr, "       [-f filter] [-m min_ms] [-r repeat] [-n]\n");
+	fprintf(stderr, "  -n  skip cases that need a GL context\n");
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct bench_case *c;
+	const char *baseline_file, *filter, *out_file;
+	double threshold, min_ns, ns_per_op, base, change;
+	int opt, repeat, no_gl, has_gl, regressions, saved_stdout, null_fd;
+	long iterations;
+
+	baseline_file = NULL;
+	filter = NULL;
+	out_file = NULL;
+	threshold = 10.0;
+	min_ns = 200e6;
+	repeat = 5;
+	no_gl = 0;
+
+	while((opt = getopt(argc, argv, "b:t:o:f:m:r:nh")) != -1) {
+		switch(opt) {
+			case 'b':
+				baseline_file = optarg;
+			break;
+			case 't':
+				threshold = atof(optarg);
+			break;
+			case 'o':
+				out_file = optarg;
+			break;
+			case 'f':
+				filter = optarg;
+			break;
+			case 'm':
+				min_ns = atof(optarg) * 1e6;
+			break;
+			case 'r':
+				repeat = atoi(optarg);
+				if(repeat < 1) repeat = 1;
+				if(repeat > 32) repeat = 32;
+			break;
+			case 'n':
+				no_gl = 1;
+			break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+
+	if(baseline_file && load_baseline(baseline_file) != 0) {
+		return 2;
+	}
+
+	// Library functions may print to stdout, so results go through
+	// their own descriptor and stdout is muted while a case runs
+
+	fflush(stdout);
+	saved_stdout = dup(1);
+	results = fdopen(dup(saved_stdout), "w");
+	null_fd = open("/dev/null", O_WRONLY);
+
+	has_gl = 0;
+	if(!no_gl) {
+		if(bench_create_context(WIDTH, HEIGHT) == 0) {
+			has_gl = 1;
+			write_file(vertex_path, vertex_source);
+			write_file(fragment_path, fragment_source);
+			write_texture(texture_path, 256, 256);
+			write_atlas(atlas_path, texture_path);
+			write_dtx(dtx_path, 256);
+			dash_watch_shaders(vertex_path, fragment_path);
+			dash_stream_init(2, 2.0);
+			if(dash_hud_init("sdr/hud_vertex.glsl", "sdr/hud_fragment.glsl") == 0) {
+				dash_hud_toggle();
+			}
+		} else {
+			fprintf(stderr, "Skipping GL cases\n");
+		}
+	}
+
+	output = NULL;
+	if(out_file) {
+		output = fopen(out_file, "w");
+		if(!output) {
+			fprintf(stderr, "Could not open %s for writing\n", out_file);
+			return 2;
+		}
+	}
+
+	report("# name\titerations\tns_per_op\tops_per_sec\n");
+	regressions = 0;
+
+	for(c = cases; c->name; c++) {
+
+		if(filter && !strstr(c->name, filter)) {
+			continue;
+		}
+		if(c->needs_gl && !has_gl) {
+			continue;
+		}
+
+		fflush(stdout);
+		dup2(null_fd, 1);
+		ns_per_op = measure(c, min_ns, repeat, &iterations);
+		fflush(stdout);
+		dup2(saved_stdout, 1);
+
+		report("%s\t%ld\t%.3f\t%.1f\n", c->name, iterations,
+			ns_per_op, 1e9 / ns_per_op);
+
+		base = baseline_lookup(c->name);
+		if(base > 0.0) {
+			change = (ns_per_op - base) / base * 100.0;
+			if(change > threshold) {
+				fprintf(stderr, "REGRESSION %s: %.3f ns -> %.3f ns (+%.1f%%, threshold %.1f%%)\n",
+					c->name, base, ns_per_op, change, threshold);
+				regressions++;
+			}
+		}
+
+	}
+
+	if(has_gl) {
+		dash_stream_shutdown();
+		unlink(vertex_path);
+		unlink(fragment_path);
+		unlink(texture_path);
+		unlink(atlas_path);
+		unlink(dtx_path);
+	}
+
+	close(null_fd);
+	fclose(results);
+	if(output) {
+		fclose(output);
+	}
+
+	if(regressions) {
+		fprintf(stderr, "%d case(s) regressed by more than %.1f%%\n", regressions, threshold);
+		return 1;
+	}
+
+	return 0;
+
+}
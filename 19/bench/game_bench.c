@@ -0,0 +1,226 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Scaling benchmark for the game module on generated lattice levels.
+ *
+ * Every combination of brick count (-s) and ball count (-b) gets a
+ * fresh level, is ticked (-t) times and then rendered (-f) times into
+ * a 640x480 headless EGL surface. Results are tab separated values:
+ *
+ *     bricks	balls	ns_per_tick	ns_per_ball_tick	frame_ms	draws	gen_ms	map_ms
+ *
+ * gen_ms is the time to generate the level in memory, map_ms the time
+ * to load the same level from a .lvl file with level_map.
+ *
+ * With -n, or when no GL context can be created, only ticks are
+ * measured and frame_ms and draws are reported as 0.
+ */
+
+#include <time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+#include "context.h"
+#include "../level.h"
+#include "../game.h"
+
+#define WIDTH 640
+#define HEIGHT 480
+#define MAX_STEPS 32
+
+static double now_ns() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}
+
+static int parse_list(const char *list, long *values) {
+
+	char *copy, *token, *save;
+	int count;
+
+	copy = strdup(list);
+	count = 0;
+	for(token = strtok_r(copy, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+		if(count == MAX_STEPS) {
+			break;
+		}
+		values[count] = atol(token);
+		if(values[count] > 0) {
+			count++;
+		}
+	}
+	free(copy);
+	return count;
+
+}
+
+static void usage(const char *argv0) {
+
+	fprintf(stderr, "Usage: %s [-s bricks,...] [-b balls,...] [-t ticks] [-f frames] [-n]\n", argv0);
+	fprintf(stderr, "  -s  brick counts, default 1000,10000,100000,1000000\n");
+	fprintf(stderr, "  -b  ball counts, default 1,16,256\n");
+	fprintf(stderr, "  -n  skip rendering\n");
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct level *level;
+	struct game game;
+	struct game_gfx gfx;
+	long sizes[MAX_STEPS], balls[MAX_STEPS];
+	int num_sizes, num_balls, opt, ticks, frames, no_gl, has_gl;
+	int i, j, k, cols, rows, draws;
+	double start, tick_ns, frame_ms, gen_ms, map_ms;
+	char path[] = "/tmp/game_bench_lvl_XXXXXX.lvl";
+	vec3 paddle_pos;
+	GLuint program;
+
+	num_sizes = parse_list("1000,10000,100000,1000000", sizes);
+	num_balls = parse_list("1,16,256", balls);
+	ticks = 1000;
+	frames = 10;
+	no_gl = 0;
+
+	while((opt = getopt(argc, argv, "s:b:t:f:nh")) != -1) {
+		switch(opt) {
+			case 's':
+				num_sizes = parse_list(optarg, sizes);
+			break;
+			case 'b':
+				num_balls = parse_list(optarg, balls);
+			break;
+			case 't':
+				ticks = atoi(optarg);
+				if(ticks < 1) ticks = 1;
+			break;
+			case 'f':
+				frames = atoi(optarg);
+				if(frames < 1) frames = 1;
+			break;
+			case 'n':
+				no_gl = 1;
+			break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+
+	has_gl = 0;
+	program = 0;
+	if(!no_gl && bench_create_context(WIDTH, HEIGHT) == 0) {
+		program = dash_create_program("sdr/vertex.glsl", "sdr/fragment.glsl");
+		if(program != 0) {
+			has_gl = 1;
+			glViewport(0, 0, WIDTH, HEIGHT);
+		}
+	}
+	if(!no_gl && !has_gl) {
+		fprintf(stderr, "Skipping rendering\n");
+	}
+
+	close(mkstemps(path, 4));
+	printf("# bricks\tballs\tns_per_tick\tns_per_ball_tick\tframe_ms\tdraws\tgen_ms\tmap_ms\n");
+
+	for(i = 0; i < num_sizes; i++) {
+
+		// Same 8:3 aspect as the area the lattice fills
+		cols = (int)ceil(sqrt(sizes[i] * 8.0 / 3.0));
+		rows = (int)((sizes[i] + cols - 1) / cols);
+
+		start = now_ns();
+		level = level_lattice(cols, rows, WIDTH, HEIGHT);
+		gen_ms = (now_ns() - start) / 1e6;
+		if(level == NULL || level_save(level, path) != 0) {
+			return 1;
+		}
+		level_free(level);
+
+		start = now_ns();
+		level = level_map(path);
+		map_ms = (now_ns() - start) / 1e6;
+		level_free(level);
+
+		for(j = 0; j < num_balls; j++) {
+
+			level = level_map(path);
+			if(level == NULL) {
+				return 1;
+			}
+			game_init(&game, level, balls[j], 1234, WIDTH, HEIGHT);
+
+			start = now_ns();
+			for(k = 0; k < ticks; k++) {
+				game_tick(&game);
+			}
+			tick_ns = (now_ns() - start) / ticks;
+
+			frame_ms = 0.0;
+			draws = 0;
+			if(has_gl) {
+
+				game_gfx_init(&gfx, &game);
+				game_gfx_bind(&gfx, &game, program);
+				paddle_pos[0] = game.paddle.pos[0];
+				paddle_pos[1] = game.paddle.pos[1];
+				paddle_pos[2] = game.paddle.pos[2];
+
+				// One frame to warm up, then wait for the GPU on each one
+				game_render(&gfx, &game, paddle_pos);
+				glFinish();
+
+				start = now_ns();
+				for(k = 0; k < frames; k++) {
+					glClear(GL_COLOR_BUFFER_BIT);
+					draws = game_render(&gfx, &game, paddle_pos);
+					glFinish();
+				}
+				frame_ms = (now_ns() - start) / frames / 1e6;
+
+				game_gfx_free(&gfx);
+
+			}
+
+			printf("%d\t%d\t%.1f\t%.2f\t%.3f\t%d\t%.3f\t%.3f\n", level->count, game.balls.count,
+				tick_ns, tick_ns / game.balls.count, frame_ms, draws, gen_ms, map_ms);
+			fflush(stdout);
+
+			game_free(&game);
+			level_free(level);
+
+		}
+
+	}
+
+	if(program != 0) {
+		dash_delete_program(program);
+	}
+	unlink(path);
+
+	return 0;
+
+}
@@ -0,0 +1,186 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Keeps a particle pool topped up to -p live particles, emitted in
+ * bursts across the screen, and updates and draws it for -f frames into
+ * a 640x480 headless EGL surface, as instanced quads, as points and
+ * splatted into a texture. One line of tab separated values per mode:
+ *
+ *     mode	particles	frames	update_us	upload_us	draw_us	frame_ms	fps
+ *
+ * update_us, upload_us and draw_us are the pool's own timings, frame_ms
+ * includes emitting and waiting for the GPU. With llvmpipe,
+ * LP_NUM_THREADS=0 keeps rendering on the one core. With -n, or when no
+ * GL context can be created, only updates are measured.
+ */
+
+#include <time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+#include "../particles.h"
+#include "context.h"
+
+#define WIDTH 640
+#define HEIGHT 480
+#define BURST 24
+
+static double now_ns() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}
+
+static void usage(const char *argv0) {
+
+	fprintf(stderr, "Usage: %s [-p particles] [-f frames] [-n]\n", argv0);
+	fprintf(stderr, "  -p  live particles, default 100000\n");
+	fprintf(stderr, "  -n  skip rendering\n");
+
+}
+
+static void top_up(struct particles *particles, int target, unsigned int *seed) {
+
+	vec3 color;
+	float x, y;
+
+	while(particles->count < target) {
+		x = rand_r(seed) % WIDTH;
+		y = HEIGHT / 2 + rand_r(seed) % (HEIGHT / 2);
+		color[0] = (rand_r(seed) % 256) / 255.0f;
+		color[1] = (rand_r(seed) % 256) / 255.0f;
+		color[2] = 1.0f;
+		particles_emit(particles, x, y, color, target - particles->count < BURST ? target - particles->count : BURST);
+	}
+
+}
+
+static void run(struct particles *particles, struct particles_gfx *gfx, const char *mode, int target, int frames) {
+
+	unsigned int seed;
+	double start, frame_ns;
+	long live;
+	int frame;
+
+	// One lifetime first so the pool holds every age, as in play, and
+	// a frame to get the shaders compiled by the driver
+	seed = 1;
+	particles->count = 0;
+	for(frame = 0; frame < particles->life; frame++) {
+		particles_update(particles);
+		top_up(particles, target, &seed);
+	}
+	if(gfx) {
+		particles_render(gfx, particles);
+		glFinish();
+	}
+	memset(&particles->timings, 0, sizeof(particles->timings));
+
+	frame_ns = 0.0;
+	live = 0;
+	for(frame = 0; frame < frames; frame++) {
+
+		start = now_ns();
+		particles_update(particles);
+		top_up(particles, target, &seed);
+		live += particles->count;
+
+		if(gfx) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			particles_render(gfx, particles);
+			glFinish();
+		}
+		frame_ns += now_ns() - start;
+
+	}
+
+	printf("%s\t%ld\t%d\t%.1f\t%.1f\t%.1f\t%.3f\t%.1f\n", mode, live / frames, frames,
+		particles->timings.update_ns / frames / 1e3,
+		particles->timings.upload_ns / frames / 1e3,
+		particles->timings.draw_ns / frames / 1e3,
+		frame_ns / frames / 1e6, 1e9 * frames / frame_ns);
+	fflush(stdout);
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct particles *particles;
+	struct particles_gfx gfx;
+	int opt, target, frames, no_gl, has_gl, mode;
+
+	target = 100000;
+	frames = 300;
+	no_gl = 0;
+
+	while((opt = getopt(argc, argv, "p:f:nh")) != -1) {
+		switch(opt) {
+			case 'p':
+				target = atoi(optarg);
+			break;
+			case 'f':
+				frames = atoi(optarg);
+				if(frames < 1) frames = 1;
+			break;
+			case 'n':
+				no_gl = 1;
+			break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+
+	particles = particles_create(target, 1);
+	if(particles == NULL) {
+		return 1;
+	}
+
+	has_gl = !no_gl && bench_create_context(WIDTH, HEIGHT) == 0;
+	if(has_gl) {
+		glViewport(0, 0, WIDTH, HEIGHT);
+	} else if(!no_gl) {
+		fprintf(stderr, "Skipping rendering\n");
+	}
+
+	printf("# mode\tparticles\tframes\tupdate_us\tupload_us\tdraw_us\tframe_ms\tfps\n");
+
+	if(!has_gl) {
+		run(particles, NULL, "none", target, frames);
+	}
+
+	for(mode = PARTICLES_INSTANCED; has_gl && mode <= PARTICLES_SPLAT; mode++) {
+		if(particles_gfx_init(&gfx, particles, WIDTH, HEIGHT, mode) != 0) {
+			return 1;
+		}
+		run(particles, &gfx, particles_mode_name(gfx.mode), target, frames);
+		particles_gfx_free(&gfx);
+	}
+
+	particles_free(particles);
+
+	return 0;
+
+}
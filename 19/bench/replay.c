@@ -0,0 +1,430 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Headless replay of recorded sessions, see session.h.
+ *
+ * Each session is played back tick by tick with a frame rendered after
+ * every tick into a 640x480 EGL surface, the way the game does at
+ * 50 ticks a second. It is the training run for the profile guided
+ * release build and the benchmark that compares it against the plain
+ * build. Results are tab separated values, the fastest of -r runs:
+ *
+ *     session	ticks	frames	tick_ns	submit_us
+ *
+ * submit_us is the CPU time to issue a frame, the GPU is waited on
+ * outside of it. Given a baseline in the same format (-b), the speed-up
+ * over it is reported per session on stderr.
+ *
+ * With -a a new session is recorded instead, played by a simple
+ * autopilot that follows the lowest ball.
+ */
+
+#include <time.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+#include "context.h"
+#include "../level.h"
+#include "../game.h"
+#include "../session.h"
+
+#define WIDTH 640
+#define HEIGHT 480
+#define MAX_BASELINE 64
+
+struct {
+	char name[MAX_BASELINE][64];
+	double tick_ns[MAX_BASELINE];
+	double submit_us[MAX_BASELINE];
+	int count;
+} baseline;
+
+static FILE *output;
+
+static double now_ns() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}
+
+/******************************************************************************/
+/** Replay                                                                   **/
+/******************************************************************************/
+
+static int replay(struct session *session, GLuint program, double *tick_ns, double *submit_us) {
+
+	struct level *level;
+	struct game game;
+	struct game_gfx gfx;
+	struct session_event *event;
+	double start, ticking, submitting;
+	int next;
+
+	level = level_from_spec(session->level, WIDTH, HEIGHT);
+	if(level == NULL) {
+		return -1;
+	}
+
+	game_init(&game, level, session->balls, session->seed, WIDTH, HEIGHT);
+	if(program != 0) {
+		game_gfx_init(&gfx, &game);
+		game_gfx_bind(&gfx, &game, program);
+	}
+
+	ticking = 0.0;
+	submitting = 0.0;
+	next = 0;
+
+	while(game.ticks < session->ticks) {
+
+		// Keys apply before the tick that was next when they were pressed
+		while(next < session->num_events && session->events[next].tick <= game.ticks) {
+			event = &session->events[next++];
+			if(event->key == SESSION_LEFT) {
+				game.paddle.left_down = event->down;
+			} else {
+				game.paddle.right_down = event->down;
+			}
+		}
+
+		start = now_ns();
+		game_tick(&game);
+		ticking += now_ns() - start;
+
+		if(program == 0) {
+			continue;
+		}
+
+		glClear(GL_COLOR_BUFFER_BIT);
+		start = now_ns();
+		game_render(&gfx, &game, game.paddle.pos);
+		submitting += now_ns() - start;
+		glFinish();
+
+	}
+
+	*tick_ns = ticking / session->ticks;
+	*submit_us = program != 0 ? submitting / session->ticks / 1e3 : 0.0;
+
+	if(program != 0) {
+		game_gfx_free(&gfx);
+	}
+	game_free(&game);
+	level_free(level);
+	return 0;
+
+}
+
+/******************************************************************************/
+/** Autopilot                                                                **/
+/******************************************************************************/
+
+static int autopilot(const char *filename, const char *spec, int balls, unsigned int seed, unsigned long ticks) {
+
+	struct level *level;
+	struct game game;
+	struct game_ball *target;
+	FILE *fp;
+	float margin;
+	int i, left, right;
+
+	level = level_from_spec(spec, WIDTH, HEIGHT);
+	if(level == NULL) {
+		return -1;
+	}
+
+	game_init(&game, level, balls, seed, WIDTH, HEIGHT);
+	fp = session_record(filename, spec, game.balls.count, seed);
+	if(fp == NULL) {
+		game_free(&game);
+		level_free(level);
+		return -1;
+	}
+
+	while(game.ticks < ticks) {
+
+		// Chase the lowest ball that is on its way down
+		target = &game.balls.items[0];
+		for(i = 1; i < game.balls.count; i++) {
+			if(game.balls.items[i].dy < 0 && (target->dy >= 0 ||
+				game.balls.items[i].pos[1] < target->pos[1])) {
+				target = &game.balls.items[i];
+			}
+		}
+
+		// Starts moving once the ball is a third of the way out from the
+		// centre and keeps going until it is nearly under it
+		margin = game.paddle.left_down ? game.paddle.dx : game.paddle.width / 3;
+		left = target->pos[0] < game.paddle.pos[0] - margin;
+		margin = game.paddle.right_down ? game.paddle.dx : game.paddle.width / 3;
+		right = target->pos[0] > game.paddle.pos[0] + margin;
+
+		if(left != game.paddle.left_down) {
+			session_record_key(fp, game.ticks, SESSION_LEFT, left);
+			game.paddle.left_down = left;
+		}
+		if(right != game.paddle.right_down) {
+			session_record_key(fp, game.ticks, SESSION_RIGHT, right);
+			game.paddle.right_down = right;
+		}
+
+		game_tick(&game);
+
+	}
+
+	printf("Recorded %lu ticks, %d of %d bricks left\n", ticks, level->remaining, level->count);
+	session_record_end(fp, ticks);
+	game_free(&game);
+	level_free(level);
+	return 0;
+
+}
+
+/******************************************************************************/
+/** Baseline                                                                 **/
+/******************************************************************************/
+
+static int load_baseline(const char *filename) {
+
+	FILE *fp;
+	char line[256];
+	unsigned long ticks, frames;
+
+	fp = fopen(filename, "r");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return -1;
+	}
+
+	while(fgets(line, sizeof(line), fp) && baseline.count < MAX_BASELINE) {
+		if(line[0] == '#') {
+			continue;
+		}
+		if(sscanf(line, "%63s %lu %lu %lf %lf",
+			baseline.name[baseline.count], &ticks, &frames,
+			&baseline.tick_ns[baseline.count],
+			&baseline.submit_us[baseline.count]) == 5) {
+			baseline.count++;
+		}
+	}
+
+	fclose(fp);
+	return 0;
+
+}
+
+static int baseline_lookup(const char *name) {
+
+	int i;
+
+	for(i = 0; i < baseline.count; i++) {
+		if(strcmp(baseline.name[i], name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+
+}
+
+/******************************************************************************/
+/** Main                                                                     **/
+/******************************************************************************/
+
+static void report(const char *fmt, ...) {
+
+	va_list args;
+
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+
+	if(output) {
+		va_start(args, fmt);
+		vfprintf(output, fmt, args);
+		va_end(args);
+	}
+
+}
+
+static void usage(const char *argv0) {
+
+	fprintf(stderr, "Usage: %s [-b baseline.tsv] [-o out.tsv] [-r repeat] [-n] session...\n", argv0);
+	fprintf(stderr, "       %s -a out.txt [-l level] [-k balls] [-s seed] [-t ticks]\n", argv0);
+	fprintf(stderr, "  -n  skip rendering\n");
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct session *session;
+	const char *baseline_file, *out_file, *record_file, *spec, *name;
+	double tick_ns, submit_us, best_tick, best_submit, base, now, total_base, total_now;
+	int opt, repeat, no_gl, balls, i, j, k;
+	unsigned long ticks;
+	unsigned int seed;
+	GLuint program;
+
+	baseline_file = NULL;
+	out_file = NULL;
+	record_file = NULL;
+	spec = "classic";
+	balls = 1;
+	seed = 1;
+	ticks = 3000;
+	repeat = 3;
+	no_gl = 0;
+
+	while((opt = getopt(argc, argv, "b:o:r:na:l:k:s:t:h")) != -1) {
+		switch(opt) {
+			case 'b':
+				baseline_file = optarg;
+			break;
+			case 'o':
+				out_file = optarg;
+			break;
+			case 'r':
+				repeat = atoi(optarg);
+				if(repeat < 1) repeat = 1;
+			break;
+			case 'n':
+				no_gl = 1;
+			break;
+			case 'a':
+				record_file = optarg;
+			break;
+			case 'l':
+				spec = optarg;
+			break;
+			case 'k':
+				balls = atoi(optarg);
+			break;
+			case 's':
+				seed = strtoul(optarg, NULL, 10);
+			break;
+			case 't':
+				ticks = strtoul(optarg, NULL, 10);
+			break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+
+	if(record_file) {
+		return autopilot(record_file, spec, balls, seed, ticks) == 0 ? 0 : 1;
+	}
+
+	if(optind == argc) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	if(baseline_file && load_baseline(baseline_file) != 0) {
+		return 2;
+	}
+
+	program = 0;
+	if(!no_gl) {
+		if(bench_create_context(WIDTH, HEIGHT) == 0) {
+			program = dash_create_program("sdr/vertex.glsl", "sdr/fragment.glsl");
+			glViewport(0, 0, WIDTH, HEIGHT);
+		}
+		if(program == 0) {
+			fprintf(stderr, "Skipping rendering\n");
+		}
+	}
+
+	output = NULL;
+	if(out_file) {
+		output = fopen(out_file, "w");
+		if(!output) {
+			fprintf(stderr, "Could not open %s for writing\n", out_file);
+			return 2;
+		}
+	}
+
+	report("# session\tticks\tframes\ttick_ns\tsubmit_us\n");
+	total_base = 0.0;
+	total_now = 0.0;
+
+	for(i = optind; i < argc; i++) {
+
+		session = session_load(argv[i]);
+		if(session == NULL) {
+			return 1;
+		}
+
+		name = strrchr(argv[i], '/');
+		name = name ? name + 1 : argv[i];
+
+		best_tick = 0.0;
+		best_submit = 0.0;
+		for(k = 0; k < repeat; k++) {
+			if(replay(session, program, &tick_ns, &submit_us) != 0) {
+				return 1;
+			}
+			if(k == 0 || tick_ns < best_tick) {
+				best_tick = tick_ns;
+			}
+			if(k == 0 || submit_us < best_submit) {
+				best_submit = submit_us;
+			}
+		}
+
+		report("%s\t%lu\t%lu\t%.1f\t%.2f\n", name, session->ticks,
+			program != 0 ? session->ticks : 0, best_tick, best_submit);
+
+		j = baseline_lookup(name);
+		if(j != -1) {
+			fprintf(stderr, "%s: tick %.1f -> %.1f ns (%.2fx), submit %.2f -> %.2f us (%.2fx)\n",
+				name, baseline.tick_ns[j], best_tick, baseline.tick_ns[j] / best_tick,
+				baseline.submit_us[j], best_submit,
+				best_submit > 0.0 ? baseline.submit_us[j] / best_submit : 0.0);
+			base = baseline.tick_ns[j] + baseline.submit_us[j] * 1e3;
+			now = best_tick + best_submit * 1e3;
+			total_base += base * session->ticks;
+			total_now += now * session->ticks;
+		}
+
+		session_free(session);
+
+	}
+
+	if(total_now > 0.0) {
+		fprintf(stderr, "CPU time per session: %.2fx the speed of the baseline\n",
+			total_base / total_now);
+	}
+
+	if(program != 0) {
+		dash_delete_program(program);
+	}
+	if(output) {
+		fclose(output);
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,180 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Scrolls the camera through a world (-w, a .lvl file or COLSxROWS)
+ * under a memory cap (-m, in MiB) and renders every frame into a
+ * 640x480 headless EGL surface. One line of tab separated values:
+ *
+ *     world	chunks	frames	update_us	draw_us	frame_ms	drawn	culled
+ *     loads	evictions	peak_kib	cap_kib	waiting
+ *
+ * update_us and draw_us are the CPU time of world_update and world_draw,
+ * frame_ms includes waiting for the GPU. drawn and culled are chunks per
+ * frame, waiting counts frames where a chunk on screen was not
+ * uploaded yet.
+ */
+
+#include <time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+#include "../level.h"
+#include "../world.h"
+#include "../game.h"
+#include "context.h"
+
+#define WIDTH 640
+#define HEIGHT 480
+
+static double now_ns() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}
+
+static void usage(const char *argv0) {
+
+	fprintf(stderr, "Usage: %s [-w world] [-m cap_mib] [-v pixels_per_frame] [-f frames] [-u uploads]\n", argv0);
+	fprintf(stderr, "  -w  .lvl file or COLSxROWS, default 40x4000\n");
+	fprintf(stderr, "  -f  frames, default until the top of the world\n");
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct world *world;
+	struct game game;
+	struct game_gfx gfx;
+	const char *spec;
+	double cap, scroll, start, frame_start, update_ns, draw_ns, frame_ns;
+	long drawn, culled;
+	int opt, frames, uploads, frame, waiting;
+	GLuint program;
+
+	spec = "40x4000";
+	cap = 4.0;
+	scroll = 8.0;
+	frames = 0;
+	uploads = 4;
+
+	while((opt = getopt(argc, argv, "w:m:v:f:u:h")) != -1) {
+		switch(opt) {
+			case 'w':
+				spec = optarg;
+			break;
+			case 'm':
+				cap = atof(optarg);
+			break;
+			case 'v':
+				scroll = atof(optarg);
+			break;
+			case 'f':
+				frames = atoi(optarg);
+			break;
+			case 'u':
+				uploads = atoi(optarg);
+			break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+
+	if(bench_create_context(WIDTH, HEIGHT) != 0) {
+		return 1;
+	}
+
+	program = dash_create_program("sdr/vertex.glsl", "sdr/fragment.glsl");
+	if(program == 0) {
+		return 1;
+	}
+	glViewport(0, 0, WIDTH, HEIGHT);
+
+	world = world_open(spec, WIDTH, HEIGHT, (long)(cap * 1024 * 1024));
+	if(world == NULL) {
+		return 1;
+	}
+	world->scroll = scroll;
+	if(frames <= 0) {
+		frames = (int)ceil((world->camera_max - world->camera_min) / scroll) + 1;
+	}
+
+	game_init(&game, NULL, 1, 1, WIDTH, HEIGHT);
+	game_set_world(&game, world);
+	game_gfx_init(&gfx, &game);
+	game_gfx_bind(&gfx, &game, program);
+
+	// Wait for the first screen, as the game does behind its placeholder
+	while(world_update(world, world->num_chunks) > 0) {
+		usleep(1000);
+	}
+
+	update_ns = draw_ns = frame_ns = 0.0;
+	drawn = culled = 0;
+	waiting = 0;
+
+	for(frame = 0; frame < frames; frame++) {
+
+		frame_start = now_ns();
+		world_advance(world);
+
+		start = now_ns();
+		if(world_update(world, uploads) > 0) {
+			waiting++;
+		}
+		update_ns += now_ns() - start;
+
+		glClear(GL_COLOR_BUFFER_BIT);
+		start = now_ns();
+		dash_use_program(program);
+		dash_bind_vertex_array(gfx.vao);
+		dash_enable_attrib(gfx.attribute_coord2d);
+		world_draw(world, gfx.attribute_coord2d, gfx.attribute_color, gfx.uniform_mvp, gfx.uniform_diffuse);
+		draw_ns += now_ns() - start;
+		glFinish();
+
+		drawn += world->drawn;
+		culled += world->culled;
+		frame_ns += now_ns() - frame_start;
+
+	}
+
+	printf("# world\tchunks\tframes\tupdate_us\tdraw_us\tframe_ms\tdrawn\tculled\tloads\tevictions\tpeak_kib\tcap_kib\twaiting\n");
+	printf("%s\t%d\t%d\t%.1f\t%.1f\t%.3f\t%.1f\t%.1f\t%lu\t%lu\t%.0f\t%.0f\t%d\n",
+		spec, world->num_chunks, frames,
+		update_ns / frames / 1e3, draw_ns / frames / 1e3, frame_ns / frames / 1e6,
+		(double)drawn / frames, (double)culled / frames,
+		world->loads, world->evictions,
+		world->memory_peak / 1024.0, world->memory_cap / 1024.0, waiting);
+
+	game_gfx_free(&gfx);
+	game_free(&game);
+	world_close(world);
+	dash_delete_program(program);
+
+	return 0;
+
+}
@@ -0,0 +1,539 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <GL/glew.h>
+#include "lib/dashgl.h"
+#include "level.h"
+#include "world.h"
+#include "particles.h"
+#include "game.h"
+
+#define GAME_BURST 24
+
+/******************************************************************************/
+/** Simulation                                                               **/
+/******************************************************************************/
+
+void game_init(struct game *game, struct level *level, int num_balls, unsigned int seed, float width, float height) {
+
+	struct game_ball *ball;
+	int i;
+
+	game->width = width;
+	game->height = height;
+	game->ticks = 0;
+	game->level = level;
+	game->world = NULL;
+	game->particles = NULL;
+	game->changed.count = 0;
+	game->changed.capacity = 0;
+	game->changed.items = NULL;
+
+	game->paddle.pos[0] = width / 2.0f;
+	game->paddle.pos[1] = 40.0f;
+	game->paddle.pos[2] = 0.0f;
+	game->paddle.color[0] = 0.85f;
+	game->paddle.color[1] = 0.85f;
+	game->paddle.color[2] = 0.85f;
+	game->paddle.left_down = 0;
+	game->paddle.right_down = 0;
+	game->paddle.width = 60.0f;
+	game->paddle.height = 8.0f;
+	game->paddle.dx = 3.0f;
+
+	if(num_balls < 1) {
+		num_balls = 1;
+	}
+
+	game->balls.color[0] = 1.0f;
+	game->balls.color[1] = 1.0f;
+	game->balls.color[2] = 1.0f;
+	game->balls.radius = 15.0f;
+	game->balls.count = num_balls;
+	game->balls.items = (struct game_ball*)malloc(num_balls * sizeof(struct game_ball));
+
+	// Every ball starts in the middle heading up at a random angle, the
+	// seed makes runs repeatable
+	for(i = 0; i < num_balls; i++) {
+		ball = &game->balls.items[i];
+		ball->pos[0] = width / 2.0f;
+		ball->pos[1] = height / 2.0f;
+		ball->pos[2] = 0.0f;
+		ball->dx = (rand_r(&seed) % 5) / 10.0f + 1.0f;
+		if(rand_r(&seed) % 10 > 5) {
+			ball->dx = -ball->dx;
+		}
+		ball->dy = -2.0f;
+	}
+
+}
+
+void game_set_world(struct game *game, struct world *world) {
+
+	game->world = world;
+	game->level = NULL;
+
+}
+
+void game_free(struct game *game) {
+
+	free(game->balls.items);
+	game->balls.items = NULL;
+	game->balls.count = 0;
+	free(game->changed.items);
+	game->changed.items = NULL;
+	game->changed.count = 0;
+	game->changed.capacity = 0;
+
+}
+
+static void game_advance_ball(struct game *game, struct game_ball *ball) {
+
+	float radius;
+
+	radius = game->balls.radius;
+	ball->pos[0] += ball->dx;
+	ball->pos[1] += ball->dy;
+
+	if(ball->pos[0] + radius > game->width) {
+		ball->pos[0] = game->width - radius;
+		ball->dx = -ball->dx;
+	} else if(ball->pos[0] - radius < 0.0f) {
+		ball->pos[0] = radius;
+		ball->dx = -ball->dx;
+	}
+
+	if(ball->pos[1] + radius > game->height) {
+		ball->pos[1] = game->height - radius;
+		ball->dy = -ball->dy;
+	} else if(ball->pos[1] - radius < 0.0f) {
+		ball->pos[1] = radius;
+		ball->dy = -ball->dy;
+	}
+
+}
+
+static void game_collide_paddle(struct game *game, struct game_ball *ball) {
+
+	float bottom;
+
+	if(ball->dy >= 0) {
+		return;
+	}
+
+	bottom = ball->pos[1] - game->balls.radius;
+	if(
+		ball->pos[0] >= game->paddle.pos[0] - game->paddle.width &&
+		ball->pos[0] <= game->paddle.pos[0] + game->paddle.width &&
+		bottom >= game->paddle.pos[1] - game->paddle.height &&
+		bottom <= game->paddle.pos[1]
+	) {
+
+		ball->dy = -1.05 * ball->dy;
+
+		if(game->paddle.left_down) {
+			ball->dx -= game->paddle.dx / 4;
+		} else if(game->paddle.right_down) {
+			ball->dx += game->paddle.dx / 4;
+		}
+
+	}
+
+}
+
+static void game_brick_changed(struct game *game, struct world_chunk *chunk, int index) {
+
+	// World chunks are uploaded again as a whole
+	if(chunk) {
+		chunk->dirty = 1;
+		return;
+	}
+
+	if(game->changed.count == game->changed.capacity) {
+		game->changed.capacity = game->changed.capacity ? game->changed.capacity * 2 : 64;
+		game->changed.items = (int*)realloc(game->changed.items, game->changed.capacity * sizeof(int));
+	}
+	game->changed.items[game->changed.count++] = index;
+
+}
+
+static void game_collide_bricks(struct game *game, struct game_ball *ball) {
+
+	const struct level_brick_type *type;
+	struct world_chunk *chunk;
+	struct level *level;
+	vec3 center, color;
+	float from_x, from_y, side;
+	int index, across;
+
+	// A brick is hit when the ball's centre enters it; the level only
+	// has to look at the one grid cell under that point
+	chunk = NULL;
+	if(game->world) {
+		index = world_brick_at(game->world, ball->pos[0], ball->pos[1], &chunk);
+		level = chunk ? chunk->ready : NULL;
+	} else {
+		level = game->level;
+		index = level_brick_at(level, ball->pos[0], ball->pos[1]);
+	}
+	if(index == -1) {
+		return;
+	}
+
+	// The axis the ball crossed the brick's edge on, found from where
+	// it was a tick ago, is the one reflected. The ball is put back
+	// outside that edge, so a brick that survives the hit is not hit
+	// again from inside on the next tick
+	level_brick_center(level, index, center);
+	if(game->world) {
+		center[1] -= game->world->camera;
+	}
+	from_x = ball->pos[0] - ball->dx;
+	from_y = ball->pos[1] - ball->dy;
+
+	across = fabsf(from_x - center[0]) > level->half_width;
+	if(across) {
+		side = from_x < center[0] ? -1.0f : 1.0f;
+		ball->pos[0] = center[0] + side * (level->half_width + 0.5f);
+		ball->dx = side * fabsf(ball->dx);
+	}
+	if(!across || fabsf(from_y - center[1]) > level->half_height) {
+		side = from_y < center[1] ? -1.0f : 1.0f;
+		ball->pos[1] = center[1] + side * (level->half_height + 0.5f);
+		ball->dy = side * fabsf(ball->dy);
+	}
+
+	// Bricks with more than one hit point only lose one per hit, the
+	// type table is only looked at for bricks that were hit
+	type = &level->types[level->type[index]];
+	if(type->flags & LEVEL_TYPE_SOLID) {
+		return;
+	}
+
+	if(level->hp[index] > 1) {
+		level->hp[index]--;
+		if(type->flags & LEVEL_TYPE_CRACKS) {
+			game_brick_changed(game, chunk, index);
+		}
+		return;
+	}
+
+	if(game->particles) {
+		level_tint_color(level, level_brick_tint(level, index), color);
+		particles_emit(game->particles, center[0], center[1], color, GAME_BURST);
+	}
+
+	level->hp[index] = 0;
+	level->active[index] = 0;
+	level->remaining--;
+	game_brick_changed(game, chunk, index);
+
+}
+
+void game_tick(struct game *game) {
+
+	struct game_ball *ball;
+	int i;
+
+	if(game->world) {
+		world_advance(game->world);
+	}
+
+	for(i = 0; i < game->balls.count; i++) {
+		game_advance_ball(game, &game->balls.items[i]);
+	}
+
+	// Advance Paddle
+
+	if(game->paddle.left_down) {
+		game->paddle.pos[0] -= game->paddle.dx;
+	}
+	if(game->paddle.right_down) {
+		game->paddle.pos[0] += game->paddle.dx;
+	}
+
+	if(game->paddle.pos[0] < 0.0f) {
+		game->paddle.pos[0] = 0.0f;
+	} else if(game->paddle.pos[0] > game->width) {
+		game->paddle.pos[0] = game->width;
+	}
+
+	// Collisions
+
+	for(i = 0; i < game->balls.count; i++) {
+		ball = &game->balls.items[i];
+		game_collide_paddle(game, ball);
+		game_collide_bricks(game, ball);
+	}
+
+	if(game->particles) {
+		particles_update(game->particles);
+	}
+
+	game->ticks++;
+
+}
+
+/******************************************************************************/
+/** Rendering                                                                **/
+/******************************************************************************/
+
+void game_gfx_init(struct game_gfx *gfx, struct game *game) {
+
+	struct level_vertex *bricks;
+	GLfloat *vertices;
+	float angle, next_angle, radius, w, h;
+	long bytes;
+	int i;
+
+	glGenVertexArrays(1, &gfx->vao);
+	dash_bind_vertex_array(gfx->vao);
+
+	// Ball
+
+	gfx->ball_segments = 100;
+	radius = game->balls.radius;
+	vertices = (GLfloat*)malloc(6 * gfx->ball_segments * sizeof(GLfloat));
+
+	for(i = 0; i < gfx->ball_segments; i++) {
+
+		angle = i * 2.0f * M_PI / (gfx->ball_segments - 1);
+		next_angle = (i + 1) * 2.0f * M_PI / (gfx->ball_segments - 1);
+
+		vertices[i*6 + 0] = cos(angle) * radius;
+		vertices[i*6 + 1] = sin(angle) * radius;
+		vertices[i*6 + 2] = cos(next_angle) * radius;
+		vertices[i*6 + 3] = sin(next_angle) * radius;
+		vertices[i*6 + 4] = 0.0f;
+		vertices[i*6 + 5] = 0.0f;
+
+	}
+
+	gfx->ball_vbo = dash_create_buffer(
+		GL_ARRAY_BUFFER,
+		6 * gfx->ball_segments * sizeof(GLfloat),
+		vertices,
+		GL_STATIC_DRAW,
+		"ball"
+	);
+	free(vertices);
+
+	// Paddle
+
+	w = game->paddle.width;
+	h = game->paddle.height;
+
+	GLfloat paddle_vertices[] = {
+		-w, -h,
+		-w,  h,
+		 w,  h,
+		 w,  h,
+		 w, -h,
+		-w, -h
+	};
+
+	gfx->paddle_vbo = dash_create_buffer(
+		GL_ARRAY_BUFFER,
+		sizeof(paddle_vertices),
+		paddle_vertices,
+		GL_STATIC_DRAW,
+		"paddle"
+	);
+
+	// Bricks, baked into one mesh that game_render patches a brick at a
+	// time, a world uploads its own per chunk
+
+	gfx->brick_vbo = 0;
+	gfx->brick_vertices = 0;
+	gfx->program = 0;
+	if(game->level == NULL) {
+		return;
+	}
+
+	gfx->brick_vertices = game->level->count * LEVEL_BRICK_VERTICES;
+	bytes = (long)gfx->brick_vertices * sizeof(struct level_vertex);
+	bricks = (struct level_vertex*)malloc(bytes);
+	for(i = 0; i < game->level->count; i++) {
+		level_brick_vertices(game->level, i, bricks + i * LEVEL_BRICK_VERTICES);
+	}
+
+	gfx->brick_vbo = dash_create_buffer(
+		GL_ARRAY_BUFFER,
+		bytes,
+		bricks,
+		GL_STATIC_DRAW,
+		"bricks"
+	);
+	free(bricks);
+
+	// The mesh already shows every change made so far
+	game->changed.count = 0;
+
+}
+
+int game_gfx_bind(struct game_gfx *gfx, struct game *game, GLuint program) {
+
+	const char *name;
+	GLint uniform_ortho;
+	mat4 ortho;
+
+	name = "coord2d";
+	gfx->attribute_coord2d = glGetAttribLocation(program, name);
+	if(gfx->attribute_coord2d == -1) {
+		fprintf(stderr, "Could not bind attribute %s\n", name);
+		return -1;
+	}
+
+	name = "color";
+	gfx->attribute_color = glGetAttribLocation(program, name);
+	if(gfx->attribute_color == -1) {
+		fprintf(stderr, "Could not bind attribute %s\n", name);
+		return -1;
+	}
+
+	name = "ortho";
+	uniform_ortho = glGetUniformLocation(program, name);
+	if(uniform_ortho == -1) {
+		fprintf(stderr, "Could not bind uniform %s\n", name);
+		return -1;
+	}
+
+	name = "mvp";
+	gfx->uniform_mvp = glGetUniformLocation(program, name);
+	if(gfx->uniform_mvp == -1) {
+		fprintf(stderr, "Could not bind uniform %s\n", name);
+		return -1;
+	}
+
+	name = "diffuse";
+	gfx->uniform_diffuse = glGetUniformLocation(program, name);
+	if(gfx->uniform_diffuse == -1) {
+		fprintf(stderr, "Could not bind uniform %s\n", name);
+		return -1;
+	}
+
+	// A new program may reuse the name of a deleted one, so nothing
+	// the state cache remembers can be trusted
+	gfx->program = program;
+	mat4_orthographic(0, game->width, game->height, 0, ortho);
+	dash_state_reset();
+	dash_use_program(program);
+	dash_uniform_matrix4fv(uniform_ortho, ortho);
+
+	return 0;
+
+}
+
+int game_render(struct game_gfx *gfx, struct game *game, vec3 paddle_pos) {
+
+	struct level_vertex vertices[LEVEL_BRICK_VERTICES];
+	struct level *level;
+	int i, index, draws;
+	mat4 mvp;
+	vec3 white;
+
+	DASH_ZONE("game_render");
+
+	// Calls go through the dashgl state cache, which drops the ones
+	// that would not change anything since the last frame
+
+	dash_use_program(gfx->program);
+	dash_bind_vertex_array(gfx->vao);
+	dash_enable_attrib(gfx->attribute_coord2d);
+	draws = 0;
+
+	// Balls and paddle are colored by diffuse alone
+
+	dash_disable_attrib(gfx->attribute_color);
+	glVertexAttrib3f(gfx->attribute_color, 1.0f, 1.0f, 1.0f);
+
+	// Balls
+
+	dash_bind_buffer(GL_ARRAY_BUFFER, gfx->ball_vbo);
+	dash_attrib_pointer(gfx->attribute_coord2d, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	dash_uniform3fv(gfx->uniform_diffuse, game->balls.color);
+
+	for(i = 0; i < game->balls.count; i++) {
+		mat4_translate(game->balls.items[i].pos, mvp);
+		dash_uniform_matrix4fv(gfx->uniform_mvp, mvp);
+		glDrawArrays(GL_TRIANGLES, 0, gfx->ball_segments * 3);
+		draws++;
+	}
+
+	// Paddle
+
+	dash_bind_buffer(GL_ARRAY_BUFFER, gfx->paddle_vbo);
+	dash_attrib_pointer(gfx->attribute_coord2d, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	mat4_translate(paddle_pos, mvp);
+	dash_uniform_matrix4fv(gfx->uniform_mvp, mvp);
+	dash_uniform3fv(gfx->uniform_diffuse, game->paddle.color);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	draws++;
+
+	// Bricks
+
+	if(game->world) {
+		return draws + world_draw(game->world, gfx->attribute_coord2d,
+			gfx->attribute_color, gfx->uniform_mvp, gfx->uniform_diffuse);
+	}
+
+	level = game->level;
+	dash_bind_buffer(GL_ARRAY_BUFFER, gfx->brick_vbo);
+
+	// Bricks hit since the last frame are rewritten in place, the ones
+	// knocked out collapse to a point
+	for(i = 0; i < game->changed.count; i++) {
+		index = game->changed.items[i];
+		level_brick_vertices(level, index, vertices);
+		glBufferSubData(GL_ARRAY_BUFFER,
+			(long)index * sizeof(vertices), sizeof(vertices), vertices);
+	}
+	game->changed.count = 0;
+
+	white[0] = white[1] = white[2] = 1.0f;
+	mat4_identity(mvp);
+	dash_uniform_matrix4fv(gfx->uniform_mvp, mvp);
+	dash_uniform3fv(gfx->uniform_diffuse, white);
+	dash_enable_attrib(gfx->attribute_color);
+	dash_attrib_pointer(gfx->attribute_coord2d, 2, GL_FLOAT, GL_FALSE,
+		sizeof(struct level_vertex), (void*)0);
+	dash_attrib_pointer(gfx->attribute_color, 3, GL_UNSIGNED_BYTE, GL_TRUE,
+		sizeof(struct level_vertex), (void*)(2 * sizeof(float)));
+	glDrawArrays(GL_TRIANGLES, 0, gfx->brick_vertices);
+	dash_disable_attrib(gfx->attribute_color);
+	draws++;
+
+	return draws;
+
+}
+
+void game_gfx_free(struct game_gfx *gfx) {
+
+	dash_delete_buffer(gfx->ball_vbo);
+	dash_delete_buffer(gfx->paddle_vbo);
+	if(gfx->brick_vbo) {
+		dash_delete_buffer(gfx->brick_vbo);
+	}
+	glDeleteVertexArrays(1, &gfx->vao);
+	dash_state_reset();
+
+}
@@ -0,0 +1,93 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BRICKOUT_GAME
+#define BRICKOUT_GAME
+
+	/**********************************************************************/
+	/** Simulation                                                       **/
+	/**********************************************************************/
+
+	struct game_ball {
+		vec3 pos;
+		float dx;
+		float dy;
+	};
+
+	struct game {
+		float width;
+		float height;
+		unsigned long ticks;
+		struct level *level;
+		struct world *world;
+		struct particles *particles;
+		struct {
+			vec3 pos;
+			vec3 color;
+			int left_down;
+			int right_down;
+			float width;
+			float height;
+			float dx;
+		} paddle;
+		struct {
+			vec3 color;
+			float radius;
+			int count;
+			struct game_ball *items;
+		} balls;
+		struct {
+			int count;
+			int capacity;
+			int *items;
+		} changed;
+	};
+
+	// Either level or world is used, world_update has to be called on
+	// the GL thread before each game_render for a world. Bricks of a
+	// level that change look are listed in changed until game_render
+	// patches them into the baked mesh. Knocked out bricks burst into
+	// particles when a pool is set, which game_tick also moves.
+	void game_init(struct game *game, struct level *level, int num_balls, unsigned int seed, float width, float height);
+	void game_set_world(struct game *game, struct world *world);
+	void game_free(struct game *game);
+	void game_tick(struct game *game);
+
+	/**********************************************************************/
+	/** Rendering                                                        **/
+	/**********************************************************************/
+
+	struct game_gfx {
+		GLuint vao;
+		GLuint ball_vbo;
+		GLuint paddle_vbo;
+		GLuint brick_vbo;
+		int brick_vertices;
+		int ball_segments;
+		GLuint program;
+		GLint attribute_coord2d;
+		GLint attribute_color;
+		GLint uniform_mvp;
+		GLint uniform_diffuse;
+	};
+
+	void game_gfx_init(struct game_gfx *gfx, struct game *game);
+	int game_gfx_bind(struct game_gfx *gfx, struct game *game, GLuint program);
+	int game_render(struct game_gfx *gfx, struct game *game, vec3 paddle_pos);
+	void game_gfx_free(struct game_gfx *gfx);
+
+#endif
@@ -0,0 +1,458 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <GL/glew.h>
+#include "lib/dashgl.h"
+#include "level.h"
+
+#define ALIGN(x) (((x) + 15) & ~15u)
+
+static const vec3 level_colors[6] = {
+	{ 1.0f, 0.0f, 0.0f },
+	{ 1.0f, 0.5f, 0.0f },
+	{ 1.0f, 1.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f },
+	{ 0.8f, 0.0f, 1.0f }
+};
+
+static const struct level_brick_type level_types[3] = {
+	{ 1, 0 },
+	{ 2, LEVEL_TYPE_CRACKS },
+	{ 1, LEVEL_TYPE_SOLID }
+};
+
+struct level *level_create(int cols, int rows) {
+
+	struct level *level;
+	int i;
+
+	level = (struct level*)calloc(1, sizeof(struct level));
+	level->cols = cols;
+	level->rows = rows;
+	level->count = cols * rows;
+	level->remaining = level->count;
+
+	level->num_colors = 6;
+	level->palette = (vec3*)calloc(LEVEL_PALETTE_SIZE, sizeof(vec3));
+	memcpy(level->palette, level_colors, sizeof(level_colors));
+
+	// Types nobody defined behave as plain bricks
+	level->types = (struct level_brick_type*)malloc(LEVEL_NUM_TYPES * sizeof(struct level_brick_type));
+	for(i = 0; i < LEVEL_NUM_TYPES; i++) {
+		level->types[i] = level_types[0];
+	}
+	memcpy(level->types, level_types, sizeof(level_types));
+
+	level->type = (unsigned char*)calloc(level->count, 1);
+	level->hp = (unsigned char*)malloc(level->count);
+	level->color = (unsigned char*)malloc(level->count);
+	level->active = (unsigned char*)malloc(level->count);
+	memset(level->hp, 1, level->count);
+	memset(level->active, 1, level->count);
+
+	dash_resource_track(DASH_RESOURCE_MEMORY, (unsigned long)level,
+		sizeof(struct level) + LEVEL_PALETTE_SIZE * sizeof(vec3) +
+		LEVEL_NUM_TYPES * sizeof(struct level_brick_type) + level->count * 4, "level");
+
+	return level;
+
+}
+
+struct level *level_classic(float width, float height) {
+
+	struct level *level;
+	int i;
+
+	// The original tutorial layout: 5 columns of 28 pixel tall bricks
+	// with 5 and 2 pixel gaps, one color per row. The columns share the
+	// width, which makes the bricks 122 pixels wide on a 640 screen
+	level = level_create(5, 6);
+	level->pitch_x = (width - 5.0f) / level->cols;
+	level->half_width = (level->pitch_x - 5.0f) * 0.5f;
+	level->half_height = 14.0f;
+	level->pitch_y = 2.0f * level->half_height + 2.0f;
+	level->origin_x = 5.0f + level->half_width;
+	level->origin_y = height - 2.0f - level->half_height;
+
+	for(i = 0; i < level->count; i++) {
+		level->color[i] = i / level->cols;
+	}
+
+	return level;
+
+}
+
+struct level *level_lattice(int cols, int rows, float width, float height) {
+
+	struct level *level;
+	int i;
+
+	if(cols < 1 || rows < 1) {
+		fprintf(stderr, "Could not generate a %dx%d lattice\n", cols, rows);
+		return NULL;
+	}
+
+	// Fills the top half of the screen, bricks take 90% of their cell
+	// and the colors run in bands from top to bottom
+	level = level_create(cols, rows);
+	level->pitch_x = width / cols;
+	level->pitch_y = height * 0.5f / rows;
+	level->half_width = level->pitch_x * 0.45f;
+	level->half_height = level->pitch_y * 0.45f;
+	level->origin_x = level->pitch_x * 0.5f;
+	level->origin_y = height - level->pitch_y * 0.5f;
+
+	for(i = 0; i < level->count; i++) {
+		level->color[i] = (long)(i / cols) * level->num_colors / rows;
+	}
+
+	return level;
+
+}
+
+struct level *level_from_spec(const char *spec, float width, float height) {
+
+	int cols, rows;
+
+	// "classic" for the tutorial layout, a .lvl file, otherwise COLSxROWS
+	if(strcmp(spec, "classic") == 0) {
+		return level_classic(width, height);
+	}
+
+	if(strlen(spec) > 4 && strcmp(spec + strlen(spec) - 4, ".lvl") == 0) {
+		return level_map(spec);
+	}
+
+	if(sscanf(spec, "%dx%d", &cols, &rows) != 2) {
+		fprintf(stderr, "Could not parse level %s, expected classic or COLSxROWS\n", spec);
+		return NULL;
+	}
+
+	return level_lattice(cols, rows, width, height);
+
+}
+
+static int level_section_valid(unsigned int offset, long bytes, long size) {
+
+	return offset >= sizeof(struct level_file_header) && offset + bytes <= size;
+
+}
+
+struct level *level_map(const char *filename) {
+
+	const struct level_file_header *header;
+	struct level *level;
+	unsigned char *data;
+	void *mapping;
+	struct stat st;
+	long size, count;
+	int fd;
+
+	DASH_ZONE("level_map");
+
+	fd = open(filename, O_RDONLY);
+	if(fd == -1) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return NULL;
+	}
+
+	if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct level_file_header)) {
+		fprintf(stderr, "%s is not a valid level file\n", filename);
+		close(fd);
+		return NULL;
+	}
+
+	// Private and writable, bricks are knocked out in place without the
+	// file ever changing
+	size = st.st_size;
+	mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mapping == MAP_FAILED) {
+		fprintf(stderr, "Could not map %s\n", filename);
+		return NULL;
+	}
+
+	data = (unsigned char*)mapping;
+	header = (const struct level_file_header*)data;
+	count = (long)header->cols * header->rows;
+
+	if(
+		header->magic != LEVEL_MAGIC ||
+		header->version != LEVEL_VERSION ||
+		header->cols < 1 || header->rows < 1 ||
+		count > 0x7fffffff ||
+		header->num_breakable > count ||
+		header->pitch_x <= 0.0f || header->pitch_y <= 0.0f ||
+		!level_section_valid(header->palette_offset, LEVEL_PALETTE_SIZE * sizeof(vec3), size) ||
+		!level_section_valid(header->types_offset, LEVEL_NUM_TYPES * sizeof(struct level_brick_type), size) ||
+		!level_section_valid(header->type_offset, count, size) ||
+		!level_section_valid(header->hp_offset, count, size) ||
+		!level_section_valid(header->color_offset, count, size) ||
+		!level_section_valid(header->active_offset, count, size)
+	) {
+		fprintf(stderr, "%s is not a valid level file\n", filename);
+		munmap(mapping, size);
+		return NULL;
+	}
+
+	level = (struct level*)calloc(1, sizeof(struct level));
+	level->cols = header->cols;
+	level->rows = header->rows;
+	level->count = count;
+	level->remaining = header->num_breakable;
+	level->origin_x = header->origin_x;
+	level->origin_y = header->origin_y;
+	level->pitch_x = header->pitch_x;
+	level->pitch_y = header->pitch_y;
+	level->half_width = header->half_width;
+	level->half_height = header->half_height;
+	level->num_colors = header->num_colors;
+	level->palette = (vec3*)(data + header->palette_offset);
+	level->types = (struct level_brick_type*)(data + header->types_offset);
+	level->type = data + header->type_offset;
+	level->hp = data + header->hp_offset;
+	level->color = data + header->color_offset;
+	level->active = data + header->active_offset;
+	level->map = mapping;
+	level->map_size = size;
+
+	dash_resource_track(DASH_RESOURCE_MEMORY, (unsigned long)level,
+		sizeof(struct level) + size, "level map");
+
+	return level;
+
+}
+
+static void level_write_section(FILE *fp, unsigned int *pos, unsigned int offset, const void *data, long bytes) {
+
+	static const unsigned char padding[16];
+
+	fwrite(padding, offset - *pos, 1, fp);
+	if(bytes > 0) {
+		fwrite(data, bytes, 1, fp);
+	}
+	*pos = offset + bytes;
+
+}
+
+int level_save(struct level *level, const char *filename) {
+
+	struct level_file_header header;
+	unsigned int offset, pos;
+	FILE *fp;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = LEVEL_MAGIC;
+	header.version = LEVEL_VERSION;
+	header.cols = level->cols;
+	header.rows = level->rows;
+	header.num_colors = level->num_colors;
+	header.origin_x = level->origin_x;
+	header.origin_y = level->origin_y;
+	header.pitch_x = level->pitch_x;
+	header.pitch_y = level->pitch_y;
+	header.half_width = level->half_width;
+	header.half_height = level->half_height;
+	header.num_breakable = level_count_breakable(level);
+
+	offset = ALIGN(sizeof(header));
+	header.palette_offset = offset;
+	offset = ALIGN(offset + LEVEL_PALETTE_SIZE * sizeof(vec3));
+	header.types_offset = offset;
+	offset = ALIGN(offset + LEVEL_NUM_TYPES * sizeof(struct level_brick_type));
+	header.type_offset = offset;
+	offset = ALIGN(offset + level->count);
+	header.hp_offset = offset;
+	offset = ALIGN(offset + level->count);
+	header.color_offset = offset;
+	offset = ALIGN(offset + level->count);
+	header.active_offset = offset;
+	offset = ALIGN(offset + level->count);
+
+	fp = fopen(filename, "wb");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for writing\n", filename);
+		return -1;
+	}
+
+	pos = 0;
+	level_write_section(fp, &pos, 0, &header, sizeof(header));
+	level_write_section(fp, &pos, header.palette_offset, level->palette, LEVEL_PALETTE_SIZE * sizeof(vec3));
+	level_write_section(fp, &pos, header.types_offset, level->types, LEVEL_NUM_TYPES * sizeof(struct level_brick_type));
+	level_write_section(fp, &pos, header.type_offset, level->type, level->count);
+	level_write_section(fp, &pos, header.hp_offset, level->hp, level->count);
+	level_write_section(fp, &pos, header.color_offset, level->color, level->count);
+	level_write_section(fp, &pos, header.active_offset, level->active, level->count);
+	level_write_section(fp, &pos, offset, NULL, 0);
+
+	if(fclose(fp) != 0) {
+		fprintf(stderr, "Could not write %s\n", filename);
+		return -1;
+	}
+
+	return 0;
+
+}
+
+void level_free(struct level *level) {
+
+	if(level == NULL) {
+		return;
+	}
+
+	dash_resource_untrack(DASH_RESOURCE_MEMORY, (unsigned long)level);
+
+	if(level->map) {
+		munmap(level->map, level->map_size);
+	} else {
+		free(level->palette);
+		free(level->types);
+		free(level->type);
+		free(level->hp);
+		free(level->color);
+		free(level->active);
+	}
+	free(level);
+
+}
+
+int level_count_breakable(struct level *level) {
+
+	int i, count;
+
+	count = 0;
+	for(i = 0; i < level->count; i++) {
+		if(level->active[i] && !(level->types[level->type[i]].flags & LEVEL_TYPE_SOLID)) {
+			count++;
+		}
+	}
+
+	return count;
+
+}
+
+int level_brick_tint(struct level *level, int index) {
+
+	const struct level_brick_type *type;
+
+	type = &level->types[level->type[index]];
+	if((type->flags & LEVEL_TYPE_CRACKS) && level->hp[index] < type->hp) {
+		return level->color[index] | LEVEL_TINT_CRACKED;
+	}
+
+	return level->color[index];
+
+}
+
+void level_tint_color(struct level *level, int tint, vec3 color) {
+
+	float shade;
+
+	shade = (tint & LEVEL_TINT_CRACKED) ? 0.5f : 1.0f;
+	color[0] = level->palette[tint & (LEVEL_PALETTE_SIZE - 1)][0] * shade;
+	color[1] = level->palette[tint & (LEVEL_PALETTE_SIZE - 1)][1] * shade;
+	color[2] = level->palette[tint & (LEVEL_PALETTE_SIZE - 1)][2] * shade;
+
+}
+
+void level_brick_center(struct level *level, int index, vec3 pos) {
+
+	pos[0] = level->origin_x + (index % level->cols) * level->pitch_x;
+	pos[1] = level->origin_y - (index / level->cols) * level->pitch_y;
+	pos[2] = 0.0f;
+
+}
+
+int level_brick_at(struct level *level, float x, float y) {
+
+	int col, row, index;
+	vec3 center;
+
+	// Only the grid cell under the point can hold it, so this costs the
+	// same for 30 bricks as for a million
+	col = (int)floorf((x - level->origin_x) / level->pitch_x + 0.5f);
+	row = (int)floorf((level->origin_y - y) / level->pitch_y + 0.5f);
+	if(col < 0 || col >= level->cols || row < 0 || row >= level->rows) {
+		return -1;
+	}
+
+	index = row * level->cols + col;
+	if(!level->active[index]) {
+		return -1;
+	}
+
+	level_brick_center(level, index, center);
+	if(
+		fabsf(x - center[0]) > level->half_width ||
+		fabsf(y - center[1]) > level->half_height
+	) {
+		return -1;
+	}
+
+	return index;
+
+}
+
+static unsigned char level_color_byte(float c) {
+
+	return (unsigned char)(fminf(fmaxf(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+
+}
+
+void level_brick_vertices(struct level *level, int index, struct level_vertex *v) {
+
+	float w, h;
+	vec3 pos, color;
+	unsigned char r, g, b;
+	int i;
+
+	level_brick_center(level, index, pos);
+	w = level->half_width;
+	h = level->half_height;
+	if(!level->active[index]) {
+		w = h = 0.0f;
+	}
+
+	level_tint_color(level, level_brick_tint(level, index), color);
+	r = level_color_byte(color[0]);
+	g = level_color_byte(color[1]);
+	b = level_color_byte(color[2]);
+
+	v[0].x = pos[0] - w;  v[0].y = pos[1] - h;
+	v[1].x = pos[0] - w;  v[1].y = pos[1] + h;
+	v[2].x = pos[0] + w;  v[2].y = pos[1] + h;
+	v[3].x = pos[0] + w;  v[3].y = pos[1] + h;
+	v[4].x = pos[0] + w;  v[4].y = pos[1] - h;
+	v[5].x = pos[0] - w;  v[5].y = pos[1] - h;
+
+	for(i = 0; i < LEVEL_BRICK_VERTICES; i++) {
+		v[i].color[0] = r;
+		v[i].color[1] = g;
+		v[i].color[2] = b;
+		v[i].color[3] = 255;
+	}
+
+}
@@ -0,0 +1,136 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BRICKOUT_LEVEL
+#define BRICKOUT_LEVEL
+
+	/**********************************************************************/
+	/** Level Files                                                      **/
+	/**********************************************************************/
+
+	// A .lvl file is this header followed by sections at the given
+	// offsets, each starting on a 16 byte boundary: the palette and the
+	// brick types, always LEVEL_PALETTE_SIZE and LEVEL_NUM_TYPES entries
+	// so that any color or type byte is in range, then one byte per brick
+	// for type, hit points, color and active. The planes are used
+	// straight from a private mapping of the file, so loading costs the
+	// same for 30 bricks as for a million.
+
+	#define LEVEL_MAGIC 0x564C4B42
+	#define LEVEL_VERSION 2
+	#define LEVEL_PALETTE_SIZE 256
+	#define LEVEL_NUM_TYPES 256
+
+	struct level_file_header {
+		unsigned int magic;
+		unsigned int version;
+		unsigned int cols;
+		unsigned int rows;
+		unsigned int num_breakable;
+		unsigned int num_colors;
+		float origin_x;
+		float origin_y;
+		float pitch_x;
+		float pitch_y;
+		float half_width;
+		float half_height;
+		unsigned int palette_offset;
+		unsigned int types_offset;
+		unsigned int type_offset;
+		unsigned int hp_offset;
+		unsigned int color_offset;
+		unsigned int active_offset;
+		unsigned int reserved[2];
+	};
+
+	/**********************************************************************/
+	/** Level                                                            **/
+	/**********************************************************************/
+
+	// Bricks sit on a regular grid, brick i in column i % cols and row
+	// i / cols. Rows run downwards from the top of the screen. Centres
+	// follow from the grid, so only per-brick state is stored, one byte
+	// per brick in each plane.
+	//
+	// What a brick does beyond taking hits comes from its entry in the
+	// type table, which is only looked at once a ball has hit it. Solid
+	// bricks never break and are not counted in remaining, cracking
+	// bricks are drawn darker once they have lost a hit point. Type 0 is
+	// the plain one hit brick, 1 a cracking two hit brick and 2 solid.
+
+	#define LEVEL_TYPE_SOLID 0x01
+	#define LEVEL_TYPE_CRACKS 0x02
+
+	// Bricks are drawn in tints, a palette index with LEVEL_TINT_CRACKED
+	// set for cracked bricks
+
+	#define LEVEL_TINT_CRACKED LEVEL_PALETTE_SIZE
+
+	struct level_brick_type {
+		unsigned char hp;
+		unsigned char flags;
+	};
+
+	// Every brick is meshed as 6 vertices with its tint baked in, so a
+	// whole field draws at once. Bricks that are not active collapse to
+	// a point and draw nothing.
+
+	#define LEVEL_BRICK_VERTICES 6
+
+	struct level_vertex {
+		float x;
+		float y;
+		unsigned char color[4];
+	};
+
+	struct level {
+		int cols;
+		int rows;
+		int count;
+		int remaining;
+		float origin_x;
+		float origin_y;
+		float pitch_x;
+		float pitch_y;
+		float half_width;
+		float half_height;
+		int num_colors;
+		vec3 *palette;
+		struct level_brick_type *types;
+		unsigned char *type;
+		unsigned char *hp;
+		unsigned char *color;
+		unsigned char *active;
+		void *map;
+		long map_size;
+	};
+
+	struct level *level_create(int cols, int rows);
+	struct level *level_classic(float width, float height);
+	struct level *level_lattice(int cols, int rows, float width, float height);
+	struct level *level_from_spec(const char *spec, float width, float height);
+	struct level *level_map(const char *filename);
+	int level_save(struct level *level, const char *filename);
+	void level_free(struct level *level);
+	int level_count_breakable(struct level *level);
+	int level_brick_tint(struct level *level, int index);
+	void level_tint_color(struct level *level, int tint, vec3 color);
+	void level_brick_center(struct level *level, int index, vec3 pos);
+	int level_brick_at(struct level *level, float x, float y);
+	void level_brick_vertices(struct level *level, int index, struct level_vertex *v);
+
+#endif
@@ -24,6 +24,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/inotify.h>
 #include <GL/glew.h>
 #include "dashgl.h"
 
@@ -74,237 +83,3027 @@ void vec3_normalize(vec3 a, vec3 v) {
 
 }
 
+/******************************************************************************/
+/** Profiler                                                                 **/
+/******************************************************************************/
+
+/*
+ * Each thread records finished zones into its own fixed ring buffer, so
+ * recording takes no lock; the oldest events are overwritten once a ring
+ * is full. Rings are only linked into the global list, under a mutex,
+ * the first time a thread records. dash_profile_dump writes every ring
+ * as Chrome trace-event JSON, which chrome://tracing and Perfetto open
+ * directly. Dump once the threads being traced are idle, events being
+ * written during the dump may be torn.
+ */
+
+#define DASH_PROFILE_RING 65536
+
+struct dash_profile_event {
+	const char *name;
+	unsigned long long start;
+	unsigned long long duration;
+};
+
+struct dash_profile_ring {
+	struct dash_profile_event events[DASH_PROFILE_RING];
+	unsigned long long count;
+	int tid;
+	const char *thread_name;
+	struct dash_profile_ring *next;
+};
+
+struct {
+	volatile int enabled;
+	unsigned long long epoch;
+	pthread_mutex_t lock;
+	struct dash_profile_ring *rings;
+} profile = { 0, 0, PTHREAD_MUTEX_INITIALIZER, NULL };
+
+static __thread struct dash_profile_ring *profile_ring;
+
+static unsigned long long dash_profile_now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+}
+
+static struct dash_profile_ring *dash_profile_thread_ring() {
+
+	struct dash_profile_ring *ring;
+
+	if(profile_ring) {
+		return profile_ring;
+	}
+
+	ring = (struct dash_profile_ring*)calloc(1, sizeof(struct dash_profile_ring));
+	ring->tid = (int)syscall(SYS_gettid);
+
+	pthread_mutex_lock(&profile.lock);
+	ring->next = profile.rings;
+	profile.rings = ring;
+	pthread_mutex_unlock(&profile.lock);
+
+	profile_ring = ring;
+	return ring;
+
+}
+
+void dash_profile_enable(int enable) {
+
+	if(enable && profile.epoch == 0) {
+		profile.epoch = dash_profile_now();
+	}
+	profile.enabled = enable;
+
+}
+
+void dash_profile_thread_name(const char *name) {
+
+	dash_profile_thread_ring()->thread_name = name;
+
+}
+
+struct dash_zone dash_zone_begin(const char *name) {
+
+	struct dash_zone zone;
+
+	zone.name = name;
+	zone.start = profile.enabled ? dash_profile_now() : 0;
+	return zone;
+
+}
+
+void dash_zone_end(struct dash_zone *zone) {
+
+	struct dash_profile_ring *ring;
+	struct dash_profile_event *event;
+
+	if(zone->start == 0 || !profile.enabled) {
+		return;
+	}
+
+	ring = dash_profile_thread_ring();
+	event = &ring->events[ring->count % DASH_PROFILE_RING];
+	event->name = zone->name;
+	event->start = zone->start;
+	event->duration = dash_profile_now() - zone->start;
+	ring->count++;
+
+}
+
+int dash_profile_dump(const char *filename) {
+
+	FILE *fp;
+	struct dash_profile_ring *ring;
+	struct dash_profile_event *event;
+	unsigned long long i, first;
+	int comma;
+
+	fp = fopen(filename, "w");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for writing\n", filename);
+		return -1;
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	comma = 0;
+
+	pthread_mutex_lock(&profile.lock);
+	for(ring = profile.rings; ring; ring = ring->next) {
+
+		if(ring->thread_name) {
+			fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s\"}}", comma ? ",\n" : "", ring->tid, ring->thread_name);
+			comma = 1;
+		}
+
+		first = ring->count > DASH_PROFILE_RING ? ring->count - DASH_PROFILE_RING : 0;
+		for(i = first; i < ring->count; i++) {
+			event = &ring->events[i % DASH_PROFILE_RING];
+			fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"dashgl\",\"ph\":\"X\",\"pid\":1,"
+				"\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", comma ? ",\n" : "",
+				event->name, ring->tid, (event->start - profile.epoch) / 1000.0,
+				event->duration / 1000.0);
+			comma = 1;
+		}
+
+	}
+	pthread_mutex_unlock(&profile.lock);
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return 0;
+
+}
+
+/******************************************************************************/
+/** GL Call Statistics                                                       **/
+/******************************************************************************/
+
+/*
+ * Built with -DDASH_GL_STATS, dashgl.h turns the GL calls the renderer
+ * issues per frame into calls to the dash_gl_count_* wrappers below,
+ * which bump a counter and forward to the real entry point. GL 1.1
+ * functions are called with their name in parentheses so the function
+ * like macro does not expand, later ones through the GLEW pointer.
+ *
+ * dash_gl_stats_frame closes a frame: its counts become the "last" frame
+ * and are added to a histogram per call type, bucketed by powers of two
+ * (0, 1, 2-3, 4-7, ...), so both the typical frame and the outliers show
+ * up in dash_gl_stats_print.
+ */
+
+#define DASH_GL_BUCKETS 16
+
+static const char *dash_gl_call_names[DASH_GL_CALL_COUNT] = {
+	"glClear",
+	"glBindBuffer",
+	"glBindVertexArray",
+	"glBindTexture",
+	"glUseProgram",
+	"glEnableVertexAttribArray",
+	"glDisableVertexAttribArray",
+	"glVertexAttribPointer",
+	"glUniform*",
+	"glBufferData",
+	"glBufferSubData",
+	"glDrawArrays",
+	"glDrawArraysInstanced"
+};
+
+struct {
+	struct dash_gl_stats frame;
+	struct dash_gl_stats last;
+	struct dash_gl_stats max;
+	unsigned long long sum[DASH_GL_CALL_COUNT];
+	unsigned long long sum_total;
+	unsigned long long sum_vertices;
+	unsigned int histogram[DASH_GL_CALL_COUNT][DASH_GL_BUCKETS];
+	unsigned int total_histogram[DASH_GL_BUCKETS];
+	unsigned long frames;
+} gl_stats;
+
+static int dash_gl_bucket(unsigned long count) {
+
+	int bucket;
+
+	bucket = 0;
+	while(count && bucket < DASH_GL_BUCKETS - 1) {
+		count >>= 1;
+		bucket++;
+	}
+	return bucket;
+
+}
+
+void dash_gl_stats_frame() {
+
+	struct dash_gl_stats *frame;
+	int i;
+
+	frame = &gl_stats.frame;
+	frame->total = 0;
+
+	for(i = 0; i < DASH_GL_CALL_COUNT; i++) {
+		frame->total += frame->calls[i];
+		gl_stats.sum[i] += frame->calls[i];
+		gl_stats.histogram[i][dash_gl_bucket(frame->calls[i])]++;
+		if(frame->calls[i] > gl_stats.max.calls[i]) {
+			gl_stats.max.calls[i] = frame->calls[i];
+		}
+	}
+
+	gl_stats.sum_total += frame->total;
+	gl_stats.sum_vertices += frame->vertices;
+	gl_stats.total_histogram[dash_gl_bucket(frame->total)]++;
+	if(frame->total > gl_stats.max.total) {
+		gl_stats.max.total = frame->total;
+	}
+	if(frame->vertices > gl_stats.max.vertices) {
+		gl_stats.max.vertices = frame->vertices;
+	}
+
+	gl_stats.frames++;
+	gl_stats.last = *frame;
+	memset(frame, 0, sizeof(struct dash_gl_stats));
+
+}
+
+const struct dash_gl_stats *dash_gl_stats_last() {
+
+	return &gl_stats.last;
+
+}
+
+const char *dash_gl_stats_name(int call) {
+
+	if(call < 0 || call >= DASH_GL_CALL_COUNT) {
+		return NULL;
+	}
+	return dash_gl_call_names[call];
+
+}
+
+void dash_gl_stats_reset() {
+
+	memset(&gl_stats, 0, sizeof(gl_stats));
+
+}
+
+static void dash_gl_print_histogram(FILE *fp, const unsigned int *histogram) {
+
+	int i;
+
+	for(i = 0; i < DASH_GL_BUCKETS; i++) {
+		if(histogram[i] == 0) {
+			continue;
+		}
+		if(i == 0) {
+			fprintf(fp, " 0:%u", histogram[i]);
+		} else if(i == 1) {
+			fprintf(fp, " 1:%u", histogram[i]);
+		} else if(i == DASH_GL_BUCKETS - 1) {
+			fprintf(fp, " %lu+:%u", 1UL << (i - 1), histogram[i]);
+		} else {
+			fprintf(fp, " %lu-%lu:%u", 1UL << (i - 1), (1UL << i) - 1, histogram[i]);
+		}
+	}
+	fprintf(fp, "\n");
+
+}
+
+void dash_gl_stats_print(FILE *fp) {
+
+	double frames;
+	int i;
+
+	if(gl_stats.frames == 0) {
+		fprintf(fp, "No GL frames recorded\n");
+		return;
+	}
+
+	frames = (double)gl_stats.frames;
+	fprintf(fp, "GL calls over %lu frames (avg / max per frame, histogram)\n", gl_stats.frames);
+
+	for(i = 0; i < DASH_GL_CALL_COUNT; i++) {
+		if(gl_stats.sum[i] == 0) {
+			continue;
+		}
+		fprintf(fp, "  %-28s %8.1f %6u ", dash_gl_call_names[i],
+			gl_stats.sum[i] / frames, gl_stats.max.calls[i]);
+		dash_gl_print_histogram(fp, gl_stats.histogram[i]);
+	}
+
+	fprintf(fp, "  %-28s %8.1f %6u ", "total", gl_stats.sum_total / frames, gl_stats.max.total);
+	dash_gl_print_histogram(fp, gl_stats.total_histogram);
+	fprintf(fp, "  %-28s %8.1f %6lu\n", "vertices", gl_stats.sum_vertices / frames, gl_stats.max.vertices);
+
+}
+
+void dash_gl_count_clear(GLbitfield mask) {
+
+	gl_stats.frame.calls[DASH_GL_CLEAR]++;
+	(glClear)(mask);
+
+}
+
+void dash_gl_count_bind_buffer(GLenum target, GLuint buffer) {
+
+	gl_stats.frame.calls[DASH_GL_BIND_BUFFER]++;
+	GLEW_GET_FUN(__glewBindBuffer)(target, buffer);
+
+}
+
+void dash_gl_count_bind_vertex_array(GLuint array) {
+
+	gl_stats.frame.calls[DASH_GL_BIND_VERTEX_ARRAY]++;
+	GLEW_GET_FUN(__glewBindVertexArray)(array);
+
+}
+
+void dash_gl_count_bind_texture(GLenum target, GLuint texture) {
+
+	gl_stats.frame.calls[DASH_GL_BIND_TEXTURE]++;
+	(glBindTexture)(target, texture);
+
+}
+
+void dash_gl_count_use_program(GLuint program) {
+
+	gl_stats.frame.calls[DASH_GL_USE_PROGRAM]++;
+	GLEW_GET_FUN(__glewUseProgram)(program);
+
+}
+
+void dash_gl_count_enable_attrib(GLuint index) {
+
+	gl_stats.frame.calls[DASH_GL_ENABLE_ATTRIB]++;
+	GLEW_GET_FUN(__glewEnableVertexAttribArray)(index);
+
+}
+
+void dash_gl_count_disable_attrib(GLuint index) {
+
+	gl_stats.frame.calls[DASH_GL_DISABLE_ATTRIB]++;
+	GLEW_GET_FUN(__glewDisableVertexAttribArray)(index);
+
+}
+
+void dash_gl_count_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) {
+
+	gl_stats.frame.calls[DASH_GL_ATTRIB_POINTER]++;
+	GLEW_GET_FUN(__glewVertexAttribPointer)(index, size, type, normalized, stride, pointer);
+
+}
+
+void dash_gl_count_uniform1i(GLint location, GLint v0) {
+
+	gl_stats.frame.calls[DASH_GL_UNIFORM]++;
+	GLEW_GET_FUN(__glewUniform1i)(location, v0);
+
+}
+
+void dash_gl_count_uniform1f(GLint location, GLfloat v0) {
+
+	gl_stats.frame.calls[DASH_GL_UNIFORM]++;
+	GLEW_GET_FUN(__glewUniform1f)(location, v0);
+
+}
+
+void dash_gl_count_uniform3fv(GLint location, GLsizei count, const GLfloat *value) {
+
+	gl_stats.frame.calls[DASH_GL_UNIFORM]++;
+	GLEW_GET_FUN(__glewUniform3fv)(location, count, value);
+
+}
+
+void dash_gl_count_uniform4fv(GLint location, GLsizei count, const GLfloat *value) {
+
+	gl_stats.frame.calls[DASH_GL_UNIFORM]++;
+	GLEW_GET_FUN(__glewUniform4fv)(location, count, value);
+
+}
+
+void dash_gl_count_uniform_matrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+
+	gl_stats.frame.calls[DASH_GL_UNIFORM]++;
+	GLEW_GET_FUN(__glewUniformMatrix4fv)(location, count, transpose, value);
+
+}
+
+void dash_gl_count_buffer_data(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+
+	gl_stats.frame.calls[DASH_GL_BUFFER_DATA]++;
+	GLEW_GET_FUN(__glewBufferData)(target, size, data, usage);
+
+}
+
+void dash_gl_count_buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+
+	gl_stats.frame.calls[DASH_GL_BUFFER_SUB_DATA]++;
+	GLEW_GET_FUN(__glewBufferSubData)(target, offset, size, data);
+
+}
+
+void dash_gl_count_draw_arrays(GLenum mode, GLint first, GLsizei count) {
+
+	gl_stats.frame.calls[DASH_GL_DRAW_ARRAYS]++;
+	gl_stats.frame.vertices += count;
+	(glDrawArrays)(mode, first, count);
+
+}
+
+void dash_gl_count_draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+
+	gl_stats.frame.calls[DASH_GL_DRAW_ARRAYS_INSTANCED]++;
+	gl_stats.frame.vertices += (unsigned long)count * instances;
+	GLEW_GET_FUN(__glewDrawArraysInstanced)(mode, first, count, instances);
+
+}
+
+/******************************************************************************/
+/** State Cache                                                              **/
+/******************************************************************************/
+
+/*
+ * Shadow copies of the GL state the renderer sets every frame: the array
+ * buffer, vertex array, program, attribute enables and pointers, and
+ * uniform values per program. A dash_* call whose value matches the
+ * shadow is dropped and counted as a hit, anything else is forwarded and
+ * counted as a miss. Every shadow starts out unknown, so the first call
+ * always goes through.
+ *
+ * Attribute state belongs to the bound vertex array and is forgotten
+ * when it changes. State changed behind the cache's back, deleting a
+ * bound object or relinking a program, needs dash_state_reset.
+ */
+
+#define DASH_STATE_ATTRIBS 16
+#define DASH_STATE_UNIFORMS 256
+
+struct dash_attrib_state {
+	int valid;
+	int enabled;
+	int pointer_valid;
+	GLuint buffer;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	const void *pointer;
+};
+
+struct dash_uniform_state {
+	GLuint program;
+	GLint location;
+	GLfloat value[16];
+};
+
+struct {
+	int array_buffer_valid;
+	GLuint array_buffer;
+	int vertex_array_valid;
+	GLuint vertex_array;
+	int program_valid;
+	GLuint program;
+	struct dash_attrib_state attribs[DASH_STATE_ATTRIBS];
+	struct dash_uniform_state uniforms[DASH_STATE_UNIFORMS];
+	unsigned long hits;
+	unsigned long misses;
+} state;
+
+void dash_state_reset() {
+
+	state.array_buffer_valid = 0;
+	state.vertex_array_valid = 0;
+	state.program_valid = 0;
+	memset(state.attribs, 0, sizeof(state.attribs));
+	memset(state.uniforms, 0, sizeof(state.uniforms));
+
+}
+
+void dash_state_counters(unsigned long *hits, unsigned long *misses) {
+
+	if(hits) {
+		*hits = state.hits;
+	}
+	if(misses) {
+		*misses = state.misses;
+	}
+
+}
+
+void dash_bind_buffer(GLenum target, GLuint buffer) {
+
+	// Only the array buffer is shadowed, other targets are used for
+	// uploads that rebind freely
+	if(target != GL_ARRAY_BUFFER) {
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if(state.array_buffer_valid && state.array_buffer == buffer) {
+		state.hits++;
+		return;
+	}
+
+	state.misses++;
+	state.array_buffer_valid = 1;
+	state.array_buffer = buffer;
+	glBindBuffer(target, buffer);
+
+}
+
+void dash_bind_vertex_array(GLuint array) {
+
+	if(state.vertex_array_valid && state.vertex_array == array) {
+		state.hits++;
+		return;
+	}
+
+	state.misses++;
+	state.vertex_array_valid = 1;
+	state.vertex_array = array;
+	memset(state.attribs, 0, sizeof(state.attribs));
+	glBindVertexArray(array);
+
+}
+
+void dash_use_program(GLuint program) {
+
+	if(state.program_valid && state.program == program) {
+		state.hits++;
+		return;
+	}
+
+	state.misses++;
+	state.program_valid = 1;
+	state.program = program;
+	glUseProgram(program);
+
+}
+
+void dash_enable_attrib(GLuint index) {
+
+	struct dash_attrib_state *attrib;
+
+	if(index >= DASH_STATE_ATTRIBS) {
+		glEnableVertexAttribArray(index);
+		return;
+	}
+
+	attrib = &state.attribs[index];
+	if(attrib->valid && attrib->enabled) {
+		state.hits++;
+		return;
+	}
+
+	state.misses++;
+	attrib->valid = 1;
+	attrib->enabled = 1;
+	glEnableVertexAttribArray(index);
+
+}
+
+void dash_disable_attrib(GLuint index) {
+
+	struct dash_attrib_state *attrib;
+
+	if(index >= DASH_STATE_ATTRIBS) {
+		glDisableVertexAttribArray(index);
+		return;
+	}
+
+	attrib = &state.attribs[index];
+	if(attrib->valid && !attrib->enabled) {
+		state.hits++;
+		return;
+	}
+
+	state.misses++;
+	attrib->valid = 1;
+	attrib->enabled = 0;
+	glDisableVertexAttribArray(index);
+
+}
+
+void dash_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) {
+
+	struct dash_attrib_state *attrib;
+
+	// The pointer captures the array buffer bound at the time, so the
+	// shadow is only usable when that binding is known
+	if(index >= DASH_STATE_ATTRIBS || !state.array_buffer_valid) {
+		state.misses++;
+		glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+		return;
+	}
+
+	attrib = &state.attribs[index];
+	if(
+		attrib->pointer_valid &&
+		attrib->buffer == state.array_buffer &&
+		attrib->size == size &&
+		attrib->type == type &&
+		attrib->normalized == normalized &&
+		attrib->stride == stride &&
+		attrib->pointer == pointer
+	) {
+		state.hits++;
+		return;
+	}
+
+	state.misses++;
+	attrib->pointer_valid = 1;
+	attrib->buffer = state.array_buffer;
+	attrib->size = size;
+	attrib->type = type;
+	attrib->normalized = normalized;
+	attrib->stride = stride;
+	attrib->pointer = pointer;
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+
+}
+
+static int dash_uniform_cached(GLint location, const void *value, size_t size) {
+
+	struct dash_uniform_state *uniform;
+	unsigned int slot, i;
+
+	// Uniforms are program state, without a known program there is
+	// nothing to compare against
+	if(!state.program_valid || state.program == 0) {
+		state.misses++;
+		return 0;
+	}
+
+	slot = (state.program * 31u + (unsigned int)location) % DASH_STATE_UNIFORMS;
+	for(i = 0; i < DASH_STATE_UNIFORMS; i++) {
+
+		uniform = &state.uniforms[(slot + i) % DASH_STATE_UNIFORMS];
+
+		if(uniform->program == 0) {
+			uniform->program = state.program;
+			uniform->location = location;
+			memcpy(uniform->value, value, size);
+			state.misses++;
+			return 0;
+		}
+
+		if(uniform->program == state.program && uniform->location == location) {
+			if(memcmp(uniform->value, value, size) == 0) {
+				state.hits++;
+				return 1;
+			}
+			memcpy(uniform->value, value, size);
+			state.misses++;
+			return 0;
+		}
+
+	}
+
+	// Table full, fall back to always uploading
+	state.misses++;
+	return 0;
+
+}
+
+void dash_uniform1i(GLint location, GLint value) {
+
+	if(location == -1 || dash_uniform_cached(location, &value, sizeof(GLint))) {
+		return;
+	}
+	glUniform1i(location, value);
+
+}
+
+void dash_uniform3fv(GLint location, const GLfloat *value) {
+
+	if(location == -1 || dash_uniform_cached(location, value, 3 * sizeof(GLfloat))) {
+		return;
+	}
+	glUniform3fv(location, 1, value);
+
+}
+
+void dash_uniform4fv(GLint location, const GLfloat *value) {
+
+	if(location == -1 || dash_uniform_cached(location, value, 4 * sizeof(GLfloat))) {
+		return;
+	}
+	glUniform4fv(location, 1, value);
+
+}
+
+void dash_uniform_matrix4fv(GLint location, const GLfloat *value) {
+
+	if(location == -1 || dash_uniform_cached(location, value, 16 * sizeof(GLfloat))) {
+		return;
+	}
+	glUniformMatrix4fv(location, 1, GL_FALSE, value);
+
+}
+
+/******************************************************************************/
+/** Resource Registry                                                        **/
+/******************************************************************************/
+
+/*
+ * Every buffer, texture and program dashgl creates is recorded here with
+ * its size in bytes and a tag naming where it came from, usually the
+ * file it was loaded from. Host memory dashgl holds on to (decoded
+ * images in flight, atlas tables, the HUD's vertex array) is recorded
+ * the same way, keyed by address. Totals and peaks are kept per type.
+ *
+ * Objects created outside dashgl can be added with dash_resource_track,
+ * or made with dash_create_buffer, and should be released with the
+ * dash_delete_* functions so they leave the registry. Whatever is still
+ * registered at shutdown is listed by dash_resource_leaks.
+ *
+ * Sizes are what was uploaded, drivers may pad or convert formats. The
+ * registry is a flat array searched from the newest entry, which suits
+ * the few hundred objects a game like this creates.
+ */
+
+struct dash_resource {
+	int type;
+	unsigned long id;
+	long bytes;
+	char tag[96];
+};
+
+static const char *dash_resource_names[DASH_RESOURCE_TYPES] = {
+	"buffers",
+	"textures",
+	"programs",
+	"host memory"
+};
+
+struct {
+	pthread_mutex_t lock;
+	struct dash_resource *items;
+	int count;
+	int capacity;
+	int objects[DASH_RESOURCE_TYPES];
+	long live[DASH_RESOURCE_TYPES];
+	long peak[DASH_RESOURCE_TYPES];
+} registry = { PTHREAD_MUTEX_INITIALIZER };
+
+static int dash_resource_find(int type, unsigned long id) {
+
+	int i;
+
+	for(i = registry.count - 1; i >= 0; i--) {
+		if(registry.items[i].type == type && registry.items[i].id == id) {
+			return i;
+		}
+	}
+	return -1;
+
+}
+
+static void dash_resource_add_bytes(int type, long bytes) {
+
+	registry.live[type] += bytes;
+	if(registry.live[type] > registry.peak[type]) {
+		registry.peak[type] = registry.live[type];
+	}
+
+}
+
+void dash_resource_track(int type, unsigned long id, long bytes, const char *tag) {
+
+	struct dash_resource *item;
+	int index;
+
+	if(type < 0 || type >= DASH_RESOURCE_TYPES || id == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&registry.lock);
+
+	// GL reuses names, a name tracked twice was deleted behind our back
+	index = dash_resource_find(type, id);
+	if(index != -1) {
+		registry.live[type] -= registry.items[index].bytes;
+		registry.objects[type]--;
+		registry.items[index] = registry.items[--registry.count];
+	}
+
+	if(registry.count == registry.capacity) {
+		registry.capacity = registry.capacity ? registry.capacity * 2 : 64;
+		registry.items = (struct dash_resource*)realloc(registry.items,
+			registry.capacity * sizeof(struct dash_resource));
+	}
+
+	item = &registry.items[registry.count++];
+	item->type = type;
+	item->id = id;
+	item->bytes = bytes;
+	snprintf(item->tag, sizeof(item->tag), "%s", tag ? tag : "untagged");
+
+	registry.objects[type]++;
+	dash_resource_add_bytes(type, bytes);
+
+	pthread_mutex_unlock(&registry.lock);
+
+}
+
+void dash_resource_resize(int type, unsigned long id, long bytes) {
+
+	int index;
+
+	pthread_mutex_lock(&registry.lock);
+	index = dash_resource_find(type, id);
+	if(index != -1) {
+		dash_resource_add_bytes(type, bytes - registry.items[index].bytes);
+		registry.items[index].bytes = bytes;
+	}
+	pthread_mutex_unlock(&registry.lock);
+
+}
+
+void dash_resource_untrack(int type, unsigned long id) {
+
+	int index;
+
+	pthread_mutex_lock(&registry.lock);
+	index = dash_resource_find(type, id);
+	if(index != -1) {
+		registry.live[type] -= registry.items[index].bytes;
+		registry.objects[type]--;
+		registry.items[index] = registry.items[--registry.count];
+	}
+	pthread_mutex_unlock(&registry.lock);
+
+}
+
+void dash_resource_totals(int type, int *objects, long *live_bytes, long *peak_bytes) {
+
+	pthread_mutex_lock(&registry.lock);
+	if(objects) {
+		*objects = registry.objects[type];
+	}
+	if(live_bytes) {
+		*live_bytes = registry.live[type];
+	}
+	if(peak_bytes) {
+		*peak_bytes = registry.peak[type];
+	}
+	pthread_mutex_unlock(&registry.lock);
+
+}
+
+void dash_resource_print(FILE *fp) {
+
+	int i;
+
+	pthread_mutex_lock(&registry.lock);
+	fprintf(fp, "Resources          objects     live KB     peak KB\n");
+	for(i = 0; i < DASH_RESOURCE_TYPES; i++) {
+		fprintf(fp, "  %-16s %7d %11.1f %11.1f\n", dash_resource_names[i],
+			registry.objects[i], registry.live[i] / 1024.0, registry.peak[i] / 1024.0);
+	}
+	pthread_mutex_unlock(&registry.lock);
+
+}
+
+int dash_resource_leaks(FILE *fp) {
+
+	struct dash_resource *item;
+	int i, count;
+
+	pthread_mutex_lock(&registry.lock);
+	count = registry.count;
+	for(i = 0; i < registry.count; i++) {
+		item = &registry.items[i];
+		fprintf(fp, "Leaked %s %lu: %ld bytes, %s\n",
+			dash_resource_names[item->type], item->id, item->bytes, item->tag);
+	}
+	pthread_mutex_unlock(&registry.lock);
+
+	return count;
+
+}
+
+GLuint dash_create_buffer(GLenum target, GLsizeiptr size, const void *data, GLenum usage, const char *tag) {
+
+	GLuint buffer;
+
+	glGenBuffers(1, &buffer);
+	dash_bind_buffer(target, buffer);
+	glBufferData(target, size, data, usage);
+	dash_resource_track(DASH_RESOURCE_BUFFER, buffer, size, tag);
+
+	return buffer;
+
+}
+
+void dash_delete_buffer(GLuint buffer) {
+
+	// Deleting a bound buffer unbinds it
+	if(state.array_buffer_valid && state.array_buffer == buffer) {
+		state.array_buffer = 0;
+	}
+
+	dash_resource_untrack(DASH_RESOURCE_BUFFER, buffer);
+	glDeleteBuffers(1, &buffer);
+
+}
+
+void dash_delete_texture(GLuint texture) {
+
+	dash_resource_untrack(DASH_RESOURCE_TEXTURE, texture);
+	glDeleteTextures(1, &texture);
+
+}
+
+void dash_delete_program(GLuint program) {
+
+	// A program in use is only flagged for deletion and its name may be
+	// handed out again, so the next dash_use_program has to go through
+	if(state.program_valid && state.program == program) {
+		state.program_valid = 0;
+	}
+
+	dash_resource_untrack(DASH_RESOURCE_PROGRAM, program);
+	glDeleteProgram(program);
+
+}
+
+/******************************************************************************/
+/** Asset Utils                                                              **/
+/******************************************************************************/
+
+/*
+ * Executables built with tools/embed carry their shaders and images in
+ * the dash_assets table. The symbols are weak so programs linked without
+ * an asset table still work and simply read everything from disk.
+ * Files on disk win over the embedded copies, first under
+ * $DASHGL_ASSET_DIR when it is set and then relative to the working
+ * directory, so shaders edited in the tree take effect and reload
+ * without a rebuild. The embedded copy is used when neither exists.
+ */
+
+extern const struct dash_asset dash_assets[] __attribute__((weak));
+extern const int dash_asset_count __attribute__((weak));
+
+static int dash_asset_override(const char *name, char *path, size_t size) {
+
+	const char *dir;
+
+	dir = getenv("DASHGL_ASSET_DIR");
+	if(dir == NULL || dir[0] == '\0') {
+		return 0;
+	}
+
+	snprintf(path, size, "%s/%s", dir, name);
+	return 1;
+
+}
+
+const unsigned char *dash_asset_find(const char *name, long *size) {
+
+	int low, high, mid, cmp;
+
+	if(dash_assets == NULL || &dash_asset_count == NULL) {
+		return NULL;
+	}
+
+	low = 0;
+	high = dash_asset_count - 1;
+	while(low <= high) {
+		mid = (low + high) / 2;
+		cmp = strcmp(name, dash_assets[mid].name);
+		if(cmp == 0) {
+			if(size) {
+				*size = dash_assets[mid].size;
+			}
+			return dash_assets[mid].data;
+		}
+		if(cmp < 0) {
+			high = mid - 1;
+		} else {
+			low = mid + 1;
+		}
+	}
+
+	return NULL;
+
+}
+
+FILE *dash_asset_open(const char *name) {
+
+	FILE *fp;
+	const unsigned char *data;
+	long size;
+	char path[4096];
+
+	if(dash_asset_override(name, path, sizeof(path))) {
+		fp = fopen(path, "rb");
+		if(fp) {
+			return fp;
+		}
+	}
+
+	fp = fopen(name, "rb");
+	if(fp) {
+		return fp;
+	}
+
+	data = dash_asset_find(name, &size);
+	if(data != NULL && size > 0) {
+		return fmemopen((void*)data, size, "rb");
+	}
+
+	return NULL;
+
+}
+
 /******************************************************************************/
 /** Shader Utils                                                             **/
 /******************************************************************************/
 
-void dash_print_log(GLuint object) {
+void dash_print_log(GLuint object) {
+
+	char *log;
+	GLint log_length = 0;
+
+	if(glIsShader(object)) {
+		glGetShaderiv(object, GL_INFO_LOG_LENGTH, &log_length);
+	} else if(glIsProgram(object)) {
+		glGetProgramiv(object, GL_INFO_LOG_LENGTH, &log_length);
+	} else {
+		fprintf(stderr, "Not a shader or program\n");
+		return;
+	}
+
+	log = (char*)malloc(log_length);
+
+	if(glIsShader(object)) {
+		glGetShaderInfoLog(object, log_length, NULL, log);
+	} else if(glIsProgram(object)) {
+		glGetProgramInfoLog(object, log_length, NULL, log);
+	}
+
+	fprintf(stderr, "%s\n", log);
+	free(log);
+
+}
+
+static char *dash_read_file(const char *filename) {
+
+	FILE *fp;
+	int file_len;
+	char *source;
+
+	fp = dash_asset_open(filename);
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return NULL;
+	}
+	
+	fseek(fp, 0, SEEK_END);
+	file_len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	source = (char*)malloc(file_len + 1);
+	fread(source, file_len, 1, fp);
+	fclose(fp);
+	source[file_len] = '\0';
+
+	return source;
+
+}
+
+static GLuint dash_compile_shader(const char *source, const char *name, GLenum type) {
+
+	const GLchar *sources[] = {
+		source
+	};
+
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, sources, NULL);
+	glCompileShader(shader);
+
+	GLint compile_ok;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_ok);
+	if(compile_ok == GL_FALSE) {
+		fprintf(stderr, "%s: ", name);
+		dash_print_log(shader);
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+
+}
+
+GLuint dash_create_shader(const char *filename, GLenum type) {
+
+	char *source;
+	GLuint shader;
+
+	source = dash_read_file(filename);
+	if(source == NULL) {
+		return 0;
+	}
+
+	shader = dash_compile_shader(source, filename, type);
+	free(source);
+
+	return shader;
+
+}
+
+/******************************************************************************/
+/** Program Binary Cache                                                     **/
+/******************************************************************************/
+
+/*
+ * Linked programs are stored under $DASHGL_CACHE_DIR, or dashgl/ inside
+ * $XDG_CACHE_HOME or ~/.cache. Each file is named after a hash of both
+ * shader sources and the driver's GL_RENDERER and GL_VERSION strings, so
+ * editing a shader or updating the driver simply misses the cache.
+ * Every failure on this path is silent and falls back to compiling.
+ */
+
+#define DASH_CACHE_MAGIC 0x42474c44
+
+static unsigned long long dash_hash(unsigned long long h, const char *str) {
+
+	while(*str) {
+		h ^= (unsigned char)*str++;
+		h *= 0x100000001b3ULL;
+	}
+
+	// Separator so that ("ab", "c") and ("a", "bc") hash differently
+	h ^= 0xff;
+	h *= 0x100000001b3ULL;
+
+	return h;
+
+}
+
+static int dash_cache_path(const char *vs_source, const char *fs_source, char *path, size_t size) {
+
+	const char *dir, *base;
+	const char *renderer, *version;
+	unsigned long long h;
+	char parent[4096];
+
+	renderer = (const char*)glGetString(GL_RENDERER);
+	version = (const char*)glGetString(GL_VERSION);
+	if(renderer == NULL || version == NULL) {
+		return -1;
+	}
+
+	dir = getenv("DASHGL_CACHE_DIR");
+	if(dir != NULL && dir[0] != '\0') {
+		snprintf(parent, sizeof(parent), "%s", dir);
+	} else {
+		base = getenv("XDG_CACHE_HOME");
+		if(base != NULL && base[0] != '\0') {
+			snprintf(parent, sizeof(parent), "%s/dashgl", base);
+		} else {
+			base = getenv("HOME");
+			if(base == NULL) {
+				return -1;
+			}
+			snprintf(parent, sizeof(parent), "%s/.cache", base);
+			mkdir(parent, 0755);
+			snprintf(parent, sizeof(parent), "%s/.cache/dashgl", base);
+		}
+	}
+	mkdir(parent, 0755);
+
+	h = 0xcbf29ce484222325ULL;
+	h = dash_hash(h, vs_source);
+	h = dash_hash(h, fs_source);
+	h = dash_hash(h, renderer);
+	h = dash_hash(h, version);
+
+	snprintf(path, size, "%s/%016llx.bin", parent, h);
+	return 0;
+
+}
+
+static int dash_cache_supported() {
+
+	GLint num_formats;
+
+	if(!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+		return 0;
+	}
+
+	num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	return num_formats > 0;
+
+}
+
+static GLuint dash_cache_load(const char *path) {
+
+	FILE *fp;
+	long file_len;
+	unsigned int header[2];
+	void *binary;
+	GLuint program;
+	GLint link_ok;
+
+	fp = fopen(path, "rb");
+	if(!fp) {
+		return 0;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	file_len = ftell(fp) - (long)sizeof(header);
+	fseek(fp, 0, SEEK_SET);
+
+	if(file_len <= 0 || fread(header, sizeof(header), 1, fp) != 1) {
+		fclose(fp);
+		return 0;
+	}
+
+	if(header[0] != DASH_CACHE_MAGIC) {
+		fclose(fp);
+		return 0;
+	}
+
+	binary = malloc(file_len);
+	if(fread(binary, file_len, 1, fp) != 1) {
+		free(binary);
+		fclose(fp);
+		return 0;
+	}
+	fclose(fp);
+
+	program = glCreateProgram();
+	glProgramBinary(program, header[1], binary, file_len);
+	free(binary);
+
+	// A driver may reject a binary it produced earlier, in which case
+	// the link status is simply false
+
+	glGetProgramiv(program, GL_LINK_STATUS, &link_ok);
+	if(!link_ok) {
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+
+}
+
+static void dash_cache_store(const char *path, GLuint program) {
+
+	FILE *fp;
+	GLint length;
+	GLenum format;
+	unsigned int header[2];
+	void *binary;
+	char tmp_path[4096];
+
+	length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) {
+		return;
+	}
+
+	binary = malloc(length);
+	glGetProgramBinary(program, length, &length, &format, binary);
+
+	header[0] = DASH_CACHE_MAGIC;
+	header[1] = format;
+
+	// Write to a temporary name and rename so a concurrent launch never
+	// reads a partially written file
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, (int)getpid());
+	fp = fopen(tmp_path, "wb");
+	if(!fp) {
+		free(binary);
+		return;
+	}
+
+	if(
+		fwrite(header, sizeof(header), 1, fp) != 1 ||
+		fwrite(binary, length, 1, fp) != 1
+	) {
+		fclose(fp);
+		unlink(tmp_path);
+		free(binary);
+		return;
+	}
+
+	fclose(fp);
+	free(binary);
+	if(rename(tmp_path, path) != 0) {
+		unlink(tmp_path);
+	}
+
+}
+
+/******************************************************************************/
+/** Program Compilation                                                      **/
+/******************************************************************************/
+
+/*
+ * Building a program is split into starting the compile and link and
+ * completing it. Checking GL_COMPILE_STATUS or GL_LINK_STATUS forces the
+ * driver to finish, so dash_create_program starts and then waits, while
+ * the async variant leaves the job running and dash_program_poll asks
+ * GL_COMPLETION_STATUS_KHR, which never blocks, once per frame. Drivers
+ * without KHR/ARB_parallel_shader_compile report the job as complete on
+ * the first poll, which then costs the same as the synchronous path.
+ */
+
+struct dash_program_job {
+	GLuint vs;
+	GLuint fs;
+	GLuint program;
+	int use_cache;
+	char cache_path[4096];
+	char vertex[256];
+	char fragment[256];
+};
+
+static int dash_parallel_compile() {
+
+	static int supported = -1;
+
+	if(supported != -1) {
+		return supported;
+	}
+
+	supported = 0;
+	if(GLEW_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xffffffff);
+		supported = 1;
+	} else if(GLEW_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xffffffff);
+		supported = 1;
+	}
+
+	return supported;
+
+}
+
+static dash_program_job *dash_program_start(const char *vs_source, const char *fs_source, const char *vertex, const char *fragment) {
+
+	dash_program_job *job;
+	const GLchar *sources[1];
+
+	DASH_ZONE("dash_program_start");
+
+	dash_parallel_compile();
+
+	job = (dash_program_job*)calloc(1, sizeof(dash_program_job));
+	snprintf(job->vertex, sizeof(job->vertex), "%s", vertex);
+	snprintf(job->fragment, sizeof(job->fragment), "%s", fragment);
+
+	job->use_cache = dash_cache_supported();
+	if(job->use_cache) {
+		job->use_cache = dash_cache_path(vs_source, fs_source, job->cache_path, sizeof(job->cache_path)) == 0;
+	}
+
+	if(job->use_cache) {
+		job->program = dash_cache_load(job->cache_path);
+		if(job->program != 0) {
+			return job;
+		}
+	}
+
+	job->vs = glCreateShader(GL_VERTEX_SHADER);
+	sources[0] = vs_source;
+	glShaderSource(job->vs, 1, sources, NULL);
+	glCompileShader(job->vs);
+
+	job->fs = glCreateShader(GL_FRAGMENT_SHADER);
+	sources[0] = fs_source;
+	glShaderSource(job->fs, 1, sources, NULL);
+	glCompileShader(job->fs);
+
+	// Linking straight away is fine, a failed compile makes the link
+	// fail and the shader logs are checked once the job completes
+
+	job->program = glCreateProgram();
+	if(job->use_cache) {
+		glProgramParameteri(job->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glAttachShader(job->program, job->vs);
+	glAttachShader(job->program, job->fs);
+	glLinkProgram(job->program);
+
+	return job;
+
+}
+
+static void dash_program_track(dash_program_job *job) {
+
+	GLint length;
+	char tag[96];
+
+	// The binary length is the closest thing to a program's size the
+	// driver will tell
+	length = 0;
+	if(dash_cache_supported()) {
+		glGetProgramiv(job->program, GL_PROGRAM_BINARY_LENGTH, &length);
+	}
+
+	snprintf(tag, sizeof(tag), "%.45s + %.45s", job->vertex, job->fragment);
+	dash_resource_track(DASH_RESOURCE_PROGRAM, job->program, length, tag);
+
+}
+
+static int dash_program_complete(dash_program_job *job, int wait, GLuint *program) {
+
+	GLint status;
+
+	DASH_ZONE("dash_program_complete");
+
+	*program = 0;
+
+	// Loaded from the cache, nothing was compiled
+	if(job->vs == 0) {
+		dash_program_track(job);
+		*program = job->program;
+		free(job);
+		return 1;
+	}
+
+	if(!wait && dash_parallel_compile()) {
+		status = GL_FALSE;
+		glGetProgramiv(job->program, GL_COMPLETION_STATUS_KHR, &status);
+		if(status == GL_FALSE) {
+			return 0;
+		}
+	}
+
+	glGetProgramiv(job->program, GL_LINK_STATUS, &status);
+	if(!status) {
+
+		glGetShaderiv(job->vs, GL_COMPILE_STATUS, &status);
+		if(status == GL_FALSE) {
+			fprintf(stderr, "%s: ", job->vertex);
+			dash_print_log(job->vs);
+		}
+
+		glGetShaderiv(job->fs, GL_COMPILE_STATUS, &status);
+		if(status == GL_FALSE) {
+			fprintf(stderr, "%s: ", job->fragment);
+			dash_print_log(job->fs);
+		}
+
+		fprintf(stderr, "Program Link Error: ");
+		dash_print_log(job->program);
+
+		glDeleteProgram(job->program);
+		glDeleteShader(job->vs);
+		glDeleteShader(job->fs);
+		free(job);
+		return -1;
+
+	}
+
+	// The shaders are only flagged here and are freed with the program
+	glDeleteShader(job->vs);
+	glDeleteShader(job->fs);
+
+	if(job->use_cache) {
+		dash_cache_store(job->cache_path, job->program);
+	}
+
+	dash_program_track(job);
+	*program = job->program;
+	free(job);
+	return 1;
+
+}
+
+static GLuint dash_build_program(const char *vs_source, const char *fs_source, const char *vertex, const char *fragment) {
+
+	dash_program_job *job;
+	GLuint program;
+
+	DASH_ZONE("dash_create_program");
+
+	job = dash_program_start(vs_source, fs_source, vertex, fragment);
+	dash_program_complete(job, 1, &program);
+
+	return program;
+
+}
+
+GLuint dash_create_program(const char *vertex, const char *fragment) {
+
+	char *vs_source, *fs_source;
+	GLuint program;
+
+	vs_source = dash_read_file(vertex);
+	fs_source = dash_read_file(fragment);
+	if(vs_source == NULL || fs_source == NULL) {
+		free(vs_source);
+		free(fs_source);
+		return 0;
+	}
+
+	program = dash_build_program(vs_source, fs_source, vertex, fragment);
+	free(vs_source);
+	free(fs_source);
+
+	return program;
+
+}
+
+GLuint dash_create_program_source(const char *vs_source, const char *fs_source) {
+
+	return dash_build_program(vs_source, fs_source, "vertex", "fragment");
+
+}
+
+dash_program_job *dash_create_program_async(const char *vertex, const char *fragment) {
+
+	char *vs_source, *fs_source;
+	dash_program_job *job;
+
+	vs_source = dash_read_file(vertex);
+	fs_source = dash_read_file(fragment);
+	if(vs_source == NULL || fs_source == NULL) {
+		free(vs_source);
+		free(fs_source);
+		return NULL;
+	}
+
+	job = dash_program_start(vs_source, fs_source, vertex, fragment);
+	free(vs_source);
+	free(fs_source);
+
+	return job;
+
+}
+
+dash_program_job *dash_create_program_source_async(const char *vs_source, const char *fs_source) {
+
+	return dash_program_start(vs_source, fs_source, "vertex", "fragment");
+
+}
+
+int dash_program_poll(dash_program_job *job, GLuint *program) {
+
+	if(job == NULL) {
+		*program = 0;
+		return -1;
+	}
+
+	return dash_program_complete(job, 0, program);
+
+}
+
+void dash_program_cancel(dash_program_job *job) {
+
+	if(job == NULL) {
+		return;
+	}
+
+	glDeleteProgram(job->program);
+	glDeleteShader(job->vs);
+	glDeleteShader(job->fs);
+	free(job);
+
+}
+
+/******************************************************************************/
+/** Shader Hot Reload                                                        **/
+/******************************************************************************/
+
+/*
+ * A background thread blocks on an inotify descriptor for the directories
+ * holding the two shader files. When either file is rewritten the thread
+ * reads both sources and leaves them for the GL thread, which picks them
+ * up without blocking through dash_watch_changed(). Only reading happens
+ * off the GL thread; compiling must stay on the thread owning the context.
+ */
+
+struct {
+	int fd;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	char vertex[4096];
+	char fragment[4096];
+	char *vs_source;
+	char *fs_source;
+} watch = { -1 };
+
+static int dash_watch_matches(const char *path, const char *dir, const char *name) {
+
+	const char *slash;
+	size_t dir_len;
+
+	slash = strrchr(path, '/');
+	if(slash == NULL) {
+		return strcmp(dir, ".") == 0 && strcmp(path, name) == 0;
+	}
+
+	dir_len = slash - path;
+	return strlen(dir) == dir_len && strncmp(path, dir, dir_len) == 0 &&
+		strcmp(slash + 1, name) == 0;
+
+}
+
+static void dash_watch_dir(const char *path, char *dir, size_t size) {
+
+	const char *slash;
+
+	slash = strrchr(path, '/');
+	if(slash == NULL) {
+		snprintf(dir, size, ".");
+	} else {
+		snprintf(dir, size, "%.*s", (int)(slash - path), path);
+	}
+
+}
+
+static void *dash_watch_thread(void *arg) {
+
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	char vs_dir[4096], fs_dir[4096];
+	char *vs_source, *fs_source;
+	struct inotify_event *event;
+	ssize_t len;
+	char *ptr;
+	int changed;
+
+	dash_watch_dir(watch.vertex, vs_dir, sizeof(vs_dir));
+	dash_watch_dir(watch.fragment, fs_dir, sizeof(fs_dir));
+
+	for(;;) {
+
+		len = read(watch.fd, buffer, sizeof(buffer));
+		if(len <= 0) {
+			break;
+		}
+
+		changed = 0;
+		for(ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + event->len) {
+			event = (struct inotify_event*)ptr;
+			if(event->len == 0) {
+				continue;
+			}
+			if(
+				dash_watch_matches(watch.vertex, vs_dir, event->name) ||
+				dash_watch_matches(watch.fragment, fs_dir, event->name)
+			) {
+				changed = 1;
+			}
+		}
+
+		if(!changed) {
+			continue;
+		}
+
+		// Editors often save in several steps, give them a moment
+		usleep(50000);
+
+		vs_source = dash_read_file(watch.vertex);
+		fs_source = dash_read_file(watch.fragment);
+		if(vs_source == NULL || fs_source == NULL) {
+			free(vs_source);
+			free(fs_source);
+			continue;
+		}
+
+		pthread_mutex_lock(&watch.lock);
+		free(watch.vs_source);
+		free(watch.fs_source);
+		watch.vs_source = vs_source;
+		watch.fs_source = fs_source;
+		pthread_mutex_unlock(&watch.lock);
+
+	}
+
+	return NULL;
+
+}
+
+int dash_watch_shaders(const char *vertex, const char *fragment) {
+
+	char vs_dir[4096], fs_dir[4096];
+	uint32_t mask;
+
+	if(watch.fd != -1) {
+		fprintf(stderr, "Shaders are already being watched\n");
+		return -1;
+	}
+
+	// Embedded copies cannot change, so follow the override directory
+	// when one is set and the working directory otherwise
+
+	if(!dash_asset_override(vertex, watch.vertex, sizeof(watch.vertex))) {
+		snprintf(watch.vertex, sizeof(watch.vertex), "%s", vertex);
+	}
+	if(!dash_asset_override(fragment, watch.fragment, sizeof(watch.fragment))) {
+		snprintf(watch.fragment, sizeof(watch.fragment), "%s", fragment);
+	}
+	dash_watch_dir(watch.vertex, vs_dir, sizeof(vs_dir));
+	dash_watch_dir(watch.fragment, fs_dir, sizeof(fs_dir));
+
+	watch.fd = inotify_init1(IN_CLOEXEC);
+	if(watch.fd == -1) {
+		fprintf(stderr, "Could not initialize inotify\n");
+		return -1;
+	}
+
+	mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+	if(
+		inotify_add_watch(watch.fd, vs_dir, mask) == -1 ||
+		inotify_add_watch(watch.fd, fs_dir, mask) == -1
+	) {
+		fprintf(stderr, "Could not watch %s\n", vs_dir);
+		close(watch.fd);
+		watch.fd = -1;
+		return -1;
+	}
+
+	pthread_mutex_init(&watch.lock, NULL);
+	if(pthread_create(&watch.thread, NULL, dash_watch_thread, NULL) != 0) {
+		fprintf(stderr, "Could not start shader watch thread\n");
+		close(watch.fd);
+		watch.fd = -1;
+		return -1;
+	}
+	pthread_detach(watch.thread);
+
+	return 0;
+
+}
+
+int dash_watch_changed(char **vs_source, char **fs_source) {
+
+	if(watch.fd == -1) {
+		return 0;
+	}
+
+	// Never wait on the reader thread, a held lock just means next frame
+	if(pthread_mutex_trylock(&watch.lock) != 0) {
+		return 0;
+	}
+
+	if(watch.vs_source == NULL) {
+		pthread_mutex_unlock(&watch.lock);
+		return 0;
+	}
+
+	*vs_source = watch.vs_source;
+	*fs_source = watch.fs_source;
+	watch.vs_source = NULL;
+	watch.fs_source = NULL;
+	pthread_mutex_unlock(&watch.lock);
+
+	return 1;
+
+}
+
+/******************************************************************************/
+/** Texture Utils                                                            **/
+/******************************************************************************/
+
+/*
+ * Every PNG is decoded to 8 bit RGB or RGBA through libpng transforms:
+ * palettes and grayscale are expanded, tRNS chunks become alpha and 16
+ * bit channels are stripped. Rows are read one at a time straight into
+ * their place in a single buffer, so decoding costs one allocation and
+ * no intermediate copy. Interlaced images are read pass by pass into
+ * the same rows.
+ */
+
+unsigned char *dash_png_read(const char *filename, int *width, int *height, GLenum *format) {
+
+	FILE *fp;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	unsigned char header[8];
+	unsigned char * volatile data;
+	int color_type, bit_depth, num_passes, pass, y;
+	size_t rowbytes;
+
+	DASH_ZONE("dash_png_read");
+
+	fp = dash_asset_open(filename);
+	if(fp == NULL) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return NULL;
+	}
+
+	if(fread(header, 1, 8, fp) != 8) {
+		fprintf(stderr, "Could not read png header\n");
+		fclose(fp);
+		return NULL;
+	}
+
+	if (png_sig_cmp(header, 0, 8)) {
+		fprintf(stderr, "%s is not a valid png file\n", filename);
+		fclose(fp);
+		return NULL;
+	}
+
+	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png_ptr == NULL) {
+		fclose(fp);
+		return NULL;
+	}
+
+	info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == NULL) {
+		png_destroy_read_struct(&png_ptr, NULL, NULL);
+		fclose(fp);
+		return NULL;
+	}
+
+	data = NULL;
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		fprintf(stderr, "%s: png decode error\n", filename);
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		free(data);
+		fclose(fp);
+		return NULL;
+	}
+
+	png_init_io(png_ptr, fp);
+	png_set_sig_bytes(png_ptr, 8);
+	png_read_info(png_ptr, info_ptr);
+
+	color_type = png_get_color_type(png_ptr, info_ptr);
+	bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+
+	if(color_type == PNG_COLOR_TYPE_PALETTE) {
+		png_set_palette_to_rgb(png_ptr);
+	}
+	if(color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
+		png_set_expand_gray_1_2_4_to_8(png_ptr);
+	}
+	if(png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+		png_set_tRNS_to_alpha(png_ptr);
+	}
+	if(bit_depth == 16) {
+		png_set_strip_16(png_ptr);
+	}
+	if(color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+		png_set_gray_to_rgb(png_ptr);
+	}
+
+	num_passes = png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+
+	*width = png_get_image_width(png_ptr, info_ptr);
+	*height = png_get_image_height(png_ptr, info_ptr);
+	*format = png_get_channels(png_ptr, info_ptr) == 4 ? GL_RGBA : GL_RGB;
+	rowbytes = png_get_rowbytes(png_ptr, info_ptr);
+
+	data = (unsigned char*)malloc(rowbytes * *height);
+	for(pass = 0; pass < num_passes; pass++) {
+		for(y = 0; y < *height; y++) {
+			png_read_row(png_ptr, data + rowbytes * y, NULL);
+		}
+	}
+
+	png_read_end(png_ptr, NULL);
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	fclose(fp);
+
+	return data;
+
+}
+
+GLuint dash_texture_load(const char *filename) {
+
+	GLuint texture_id;
+	GLenum format;
+	int width, height;
+	unsigned char *data;
+
+	DASH_ZONE("dash_texture_load");
+
+	data = dash_png_read(filename, &width, &height, &format);
+	if(data == NULL) {
+		return 0;
+	}
+
+	// RGB rows of odd width are not 4 byte aligned
+	if(format == GL_RGB && (width * 3) % 4 != 0) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	}
+
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D,
+		0,
+		format,
+		width,
+		height,
+		0,
+		format,
+		GL_UNSIGNED_BYTE,
+		data
+	);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	free(data);
+
+	dash_resource_track(DASH_RESOURCE_TEXTURE, texture_id,
+		(long)width * height * (format == GL_RGBA ? 4 : 3), filename);
+
+	return texture_id;
+
+}
+
+/*
+ * .dtx files are written offline by tools/texconv: a fixed header
+ * followed by every mip level, ready to hand to glTexImage2D (or to
+ * glCompressedTexImage2D when the format is a compressed one). The file
+ * is mapped and uploaded straight from the mapping, so there is no
+ * decode and no copy on the CPU. Embedded copies are used in place.
+ */
+
+static int dash_dtx_compressed(GLenum format) {
+
+	return format != GL_RGBA && format != GL_RGB;
+
+}
+
+GLuint dash_texture_load_dtx(const char *filename) {
+
+	const unsigned char *data;
+	const struct dash_dtx_header *header;
+	const struct dash_dtx_level *level;
+	char path[4096];
+	void *mapping;
+	long size, bytes;
+	struct stat st;
+	int fd, i;
+	GLuint texture_id;
+
+	DASH_ZONE("dash_texture_load_dtx");
+
+	mapping = NULL;
+	data = NULL;
+	fd = -1;
+
+	if(dash_asset_override(filename, path, sizeof(path))) {
+		fd = open(path, O_RDONLY);
+	}
+	if(fd == -1) {
+		data = dash_asset_find(filename, &size);
+	}
+	if(fd == -1 && data == NULL) {
+		fd = open(filename, O_RDONLY);
+		if(fd == -1) {
+			fprintf(stderr, "Could not open %s for reading\n", filename);
+			return 0;
+		}
+	}
+
+	if(fd != -1) {
+		if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct dash_dtx_header)) {
+			fprintf(stderr, "%s is not a valid dtx file\n", filename);
+			close(fd);
+			return 0;
+		}
+		size = st.st_size;
+		mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(mapping == MAP_FAILED) {
+			fprintf(stderr, "Could not map %s\n", filename);
+			return 0;
+		}
+		data = (const unsigned char*)mapping;
+	}
+
+	header = (const struct dash_dtx_header*)data;
+	if(
+		size < (long)sizeof(struct dash_dtx_header) ||
+		header->magic != DASH_DTX_MAGIC ||
+		header->num_levels < 1 ||
+		header->num_levels > DASH_DTX_MAX_LEVELS
+	) {
+		fprintf(stderr, "%s is not a valid dtx file\n", filename);
+		if(mapping) {
+			munmap(mapping, size);
+		}
+		return 0;
+	}
+
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	bytes = 0;
+
+	for(i = 0; i < (int)header->num_levels; i++) {
+
+		level = &header->level[i];
+		if((long)level->offset + (long)level->size > size) {
+			fprintf(stderr, "%s: level %d is truncated\n", filename, i);
+			break;
+		}
+
+		if(dash_dtx_compressed(header->format)) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, header->format,
+				level->width, level->height, 0, level->size, data + level->offset);
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, i, header->format, level->width, level->height,
+				0, header->format, GL_UNSIGNED_BYTE, data + level->offset);
+		}
+		bytes += level->size;
+
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, i - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		i > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+
+	if(mapping) {
+		munmap(mapping, size);
+	}
+
+	dash_resource_track(DASH_RESOURCE_TEXTURE, texture_id, bytes, filename);
+	return texture_id;
+
+}
+
+/******************************************************************************/
+/** Texture Streaming                                                        **/
+/******************************************************************************/
+
+/*
+ * dash_stream_texture returns a texture name at once, holding a 1x1 grey
+ * placeholder, and queues the file for a pool of worker threads that run
+ * dash_png_read. Decoded images come back to the GL thread, where
+ * dash_stream_update copies them through a pixel buffer object into the
+ * texture in bands of rows. Each call stops once the per-frame budget is
+ * spent, so a large image is spread over several frames instead of
+ * stalling one.
+ */
+
+#define DASH_STREAM_BAND_BYTES (256 * 1024)
+
+struct dash_stream_item {
+	GLuint texture;
+	char filename[4096];
+	unsigned char *data;
+	int width;
+	int height;
+	GLenum format;
+	struct dash_stream_item *next;
+};
+
+struct {
+	int running;
+	int num_workers;
+	pthread_t *workers;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	struct dash_stream_item *requests;
+	struct dash_stream_item *requests_tail;
+	struct dash_stream_item *decoded;
+	struct dash_stream_item *decoded_tail;
+	struct dash_stream_item *uploading;
+	int upload_row;
+	int pending;
+	double budget_ms;
+	GLuint pbo;
+	GLuint *resident;
+	int num_resident;
+	int max_resident;
+} stream;
+
+static double dash_now_ms() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+
+}
+
+static void dash_stream_push(struct dash_stream_item **head, struct dash_stream_item **tail, struct dash_stream_item *item) {
+
+	item->next = NULL;
+	if(*tail) {
+		(*tail)->next = item;
+	} else {
+		*head = item;
+	}
+	*tail = item;
+
+}
+
+static struct dash_stream_item *dash_stream_pop(struct dash_stream_item **head, struct dash_stream_item **tail) {
+
+	struct dash_stream_item *item;
+
+	item = *head;
+	if(item) {
+		*head = item->next;
+		if(*head == NULL) {
+			*tail = NULL;
+		}
+	}
+	return item;
+
+}
+
+static void *dash_stream_worker(void *arg) {
+
+	struct dash_stream_item *item;
+
+	dash_profile_thread_name("texture stream");
+
+	pthread_mutex_lock(&stream.lock);
+	for(;;) {
+
+		while(stream.running && stream.requests == NULL) {
+			pthread_cond_wait(&stream.wake, &stream.lock);
+		}
+		if(!stream.running) {
+			break;
+		}
+
+		item = dash_stream_pop(&stream.requests, &stream.requests_tail);
+		pthread_mutex_unlock(&stream.lock);
+
+		item->data = dash_png_read(item->filename, &item->width, &item->height, &item->format);
+		if(item->data) {
+			dash_resource_track(DASH_RESOURCE_MEMORY, (unsigned long)item->data,
+				(long)item->width * item->height * (item->format == GL_RGBA ? 4 : 3),
+				item->filename);
+		}
+
+		pthread_mutex_lock(&stream.lock);
+		dash_stream_push(&stream.decoded, &stream.decoded_tail, item);
+
+	}
+	pthread_mutex_unlock(&stream.lock);
+
+	return NULL;
+
+}
+
+int dash_stream_init(int workers, double budget_ms) {
+
+	int i;
+
+	if(stream.running) {
+		fprintf(stderr, "Texture streaming already initialized\n");
+		return -1;
+	}
+
+	if(workers < 1) {
+		workers = 1;
+	}
+
+	pthread_mutex_init(&stream.lock, NULL);
+	pthread_cond_init(&stream.wake, NULL);
+	stream.running = 1;
+	stream.budget_ms = budget_ms;
+	stream.workers = (pthread_t*)malloc(workers * sizeof(pthread_t));
+	stream.num_workers = 0;
+
+	for(i = 0; i < workers; i++) {
+		if(pthread_create(&stream.workers[i], NULL, dash_stream_worker, NULL) != 0) {
+			fprintf(stderr, "Could not start texture stream worker\n");
+			break;
+		}
+		stream.num_workers++;
+	}
+
+	if(stream.num_workers == 0) {
+		stream.running = 0;
+		free(stream.workers);
+		return -1;
+	}
+
+	glGenBuffers(1, &stream.pbo);
+	dash_resource_track(DASH_RESOURCE_BUFFER, stream.pbo, 0, "texture stream");
+	return 0;
+
+}
+
+void dash_stream_budget(double budget_ms) {
+
+	stream.budget_ms = budget_ms;
+
+}
+
+GLuint dash_stream_texture(const char *filename) {
+
+	struct dash_stream_item *item;
+	GLuint texture_id;
+	unsigned char placeholder[4] = { 128, 128, 128, 255 };
+
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+	dash_resource_track(DASH_RESOURCE_TEXTURE, texture_id, 4, filename);
+
+	if(!stream.running) {
+		fprintf(stderr, "Texture streaming not initialized\n");
+		return texture_id;
+	}
+
+	item = (struct dash_stream_item*)calloc(1, sizeof(struct dash_stream_item));
+	item->texture = texture_id;
+	snprintf(item->filename, sizeof(item->filename), "%s", filename);
+
+	pthread_mutex_lock(&stream.lock);
+	dash_stream_push(&stream.requests, &stream.requests_tail, item);
+	stream.pending++;
+	pthread_cond_signal(&stream.wake);
+	pthread_mutex_unlock(&stream.lock);
+
+	return texture_id;
+
+}
+
+static void dash_stream_mark_resident(GLuint texture) {
+
+	if(stream.num_resident == stream.max_resident) {
+		stream.max_resident = stream.max_resident ? stream.max_resident * 2 : 64;
+		stream.resident = (GLuint*)realloc(stream.resident, stream.max_resident * sizeof(GLuint));
+	}
+	stream.resident[stream.num_resident++] = texture;
+
+}
+
+int dash_stream_resident(GLuint texture) {
+
+	int i;
+
+	for(i = stream.num_resident - 1; i >= 0; i--) {
+		if(stream.resident[i] == texture) {
+			return 1;
+		}
+	}
+	return 0;
+
+}
+
+static int dash_stream_upload_band(struct dash_stream_item *item) {
+
+	int bpp, rows, y;
+	size_t row_bytes, band_bytes;
+	void *ptr;
+
+	bpp = item->format == GL_RGBA ? 4 : 3;
+	row_bytes = (size_t)item->width * bpp;
+
+	rows = DASH_STREAM_BAND_BYTES / row_bytes;
+	if(rows < 1) {
+		rows = 1;
+	}
+
+	y = stream.upload_row;
+	if(y + rows > item->height) {
+		rows = item->height - y;
+	}
+	band_bytes = row_bytes * rows;
+
+	glBindTexture(GL_TEXTURE_2D, item->texture);
+	if(y == 0) {
+		glTexImage2D(GL_TEXTURE_2D, 0, item->format, item->width, item->height,
+			0, item->format, GL_UNSIGNED_BYTE, NULL);
+		dash_resource_resize(DASH_RESOURCE_TEXTURE, item->texture,
+			(long)row_bytes * item->height);
+	}
+
+	// Orphan the previous band's storage so mapping never waits on the
+	// driver still reading it
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, band_bytes, NULL, GL_STREAM_DRAW);
+	dash_resource_resize(DASH_RESOURCE_BUFFER, stream.pbo, band_bytes);
+	ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, band_bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if(ptr == NULL) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return -1;
+	}
+	memcpy(ptr, item->data + row_bytes * y, band_bytes);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, row_bytes % 4 ? 1 : 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, item->width, rows,
+		item->format, GL_UNSIGNED_BYTE, (void*)0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	stream.upload_row = y + rows;
+	return stream.upload_row == item->height;
+
+}
+
+int dash_stream_update() {
+
+	struct dash_stream_item *item;
+	double start;
+	int done, pending;
+
+	DASH_ZONE("dash_stream_update");
+
+	if(!stream.running) {
+		return 0;
+	}
+
+	start = dash_now_ms();
+
+	while(dash_now_ms() - start < stream.budget_ms) {
+
+		if(stream.uploading == NULL) {
+			pthread_mutex_lock(&stream.lock);
+			item = dash_stream_pop(&stream.decoded, &stream.decoded_tail);
+			pthread_mutex_unlock(&stream.lock);
+			if(item == NULL) {
+				break;
+			}
+
+			// Failed decodes keep the placeholder
+			if(item->data == NULL) {
+				pthread_mutex_lock(&stream.lock);
+				stream.pending--;
+				pthread_mutex_unlock(&stream.lock);
+				free(item);
+				continue;
+			}
+
+			stream.uploading = item;
+			stream.upload_row = 0;
+		}
+
+		item = stream.uploading;
+		done = dash_stream_upload_band(item);
+		if(done == 0) {
+			continue;
+		}
+
+		if(done == 1) {
+			dash_stream_mark_resident(item->texture);
+		}
+		dash_resource_untrack(DASH_RESOURCE_MEMORY, (unsigned long)item->data);
+		free(item->data);
+		free(item);
+		stream.uploading = NULL;
+
+		pthread_mutex_lock(&stream.lock);
+		stream.pending--;
+		pthread_mutex_unlock(&stream.lock);
+
+	}
+
+	pthread_mutex_lock(&stream.lock);
+	pending = stream.pending;
+	pthread_mutex_unlock(&stream.lock);
+
+	return pending;
 
-	char *log;
-	GLint log_length = 0;
+}
 
-	if(glIsShader(object)) {
-		glGetShaderiv(object, GL_INFO_LOG_LENGTH, &log_length);
-	} else if(glIsProgram(object)) {
-		glGetProgramiv(object, GL_INFO_LOG_LENGTH, &log_length);
-	} else {
-		fprintf(stderr, "Not a shader or program\n");
+void dash_stream_shutdown() {
+
+	struct dash_stream_item *item;
+	int i;
+
+	if(!stream.running) {
 		return;
 	}
 
-	log = (char*)malloc(log_length);
+	pthread_mutex_lock(&stream.lock);
+	stream.running = 0;
+	pthread_cond_broadcast(&stream.wake);
+	pthread_mutex_unlock(&stream.lock);
 
-	if(glIsShader(object)) {
-		glGetShaderInfoLog(object, log_length, NULL, log);
-	} else if(glIsProgram(object)) {
-		glGetProgramInfoLog(object, log_length, NULL, log);
+	for(i = 0; i < stream.num_workers; i++) {
+		pthread_join(stream.workers[i], NULL);
 	}
+	free(stream.workers);
 
-	fprintf(stderr, "%s\n", log);
-	free(log);
+	while((item = dash_stream_pop(&stream.requests, &stream.requests_tail))) {
+		free(item);
+	}
+	while((item = dash_stream_pop(&stream.decoded, &stream.decoded_tail))) {
+		dash_resource_untrack(DASH_RESOURCE_MEMORY, (unsigned long)item->data);
+		free(item->data);
+		free(item);
+	}
+	if(stream.uploading) {
+		dash_resource_untrack(DASH_RESOURCE_MEMORY, (unsigned long)stream.uploading->data);
+		free(stream.uploading->data);
+		free(stream.uploading);
+		stream.uploading = NULL;
+	}
+
+	dash_delete_buffer(stream.pbo);
+	free(stream.resident);
+	stream.resident = NULL;
+	stream.num_resident = 0;
+	stream.max_resident = 0;
+	stream.pending = 0;
+
+	pthread_mutex_destroy(&stream.lock);
+	pthread_cond_destroy(&stream.wake);
 
 }
 
-GLuint dash_create_shader(const char *filename, GLenum type) {
+/******************************************************************************/
+/** Atlas Utils                                                              **/
+/******************************************************************************/
+
+/*
+ * Reads the .atlas metadata written by tools/atlas and loads its pages
+ * as textures. Sprites are listed sorted by name, so lookups use binary
+ * search. Page files are resolved relative to the metadata file.
+ */
+
+struct dash_atlas_sprite {
+	char *name;
+	int page;
+	float u0, v0, u1, v1;
+};
+
+struct dash_atlas {
+	int num_pages;
+	GLuint *textures;
+	int num_sprites;
+	struct dash_atlas_sprite *sprites;
+};
+
+dash_atlas *dash_atlas_load(const char *filename) {
 
 	FILE *fp;
-	int file_len;
-	char *source;
+	dash_atlas *atlas;
+	struct dash_atlas_sprite *sprite;
+	char line[1024], name[512], path[4096];
+	int version, index, page, x, y, w, h, max_sprites, dir_len;
+	int *page_w, *page_h;
+	const char *slash;
+
+	DASH_ZONE("dash_atlas_load");
 
-	fp = fopen(filename, "rb");
+	fp = dash_asset_open(filename);
 	if(!fp) {
 		fprintf(stderr, "Could not open %s for reading\n", filename);
-		return 0;
+		return NULL;
+	}
+
+	if(!fgets(line, sizeof(line), fp) || sscanf(line, "dashgl-atlas %d", &version) != 1 || version != 1) {
+		fprintf(stderr, "%s is not a valid atlas file\n", filename);
+		fclose(fp);
+		return NULL;
+	}
+
+	slash = strrchr(filename, '/');
+	dir_len = slash ? (int)(slash - filename) + 1 : 0;
+
+	atlas = (dash_atlas*)calloc(1, sizeof(dash_atlas));
+	page_w = NULL;
+	page_h = NULL;
+	max_sprites = 0;
+
+	while(fgets(line, sizeof(line), fp)) {
+
+		if(sscanf(line, "page %d %511s %d %d", &index, name, &w, &h) == 4) {
+
+			if(index != atlas->num_pages) {
+				fprintf(stderr, "%s: pages out of order\n", filename);
+				break;
+			}
+
+			snprintf(path, sizeof(path), "%.*s%s", dir_len, filename, name);
+			atlas->num_pages++;
+			atlas->textures = (GLuint*)realloc(atlas->textures, atlas->num_pages * sizeof(GLuint));
+			page_w = (int*)realloc(page_w, atlas->num_pages * sizeof(int));
+			page_h = (int*)realloc(page_h, atlas->num_pages * sizeof(int));
+			atlas->textures[index] = dash_texture_load(path);
+			page_w[index] = w;
+			page_h[index] = h;
+
+		} else if(sscanf(line, "sprite %511s %d %d %d %d %d", name, &page, &x, &y, &w, &h) == 6) {
+
+			if(page < 0 || page >= atlas->num_pages) {
+				fprintf(stderr, "%s: sprite %s has no page %d\n", filename, name, page);
+				continue;
+			}
+
+			if(atlas->num_sprites == max_sprites) {
+				max_sprites = max_sprites ? max_sprites * 2 : 64;
+				atlas->sprites = (struct dash_atlas_sprite*)realloc(atlas->sprites,
+					max_sprites * sizeof(struct dash_atlas_sprite));
+			}
+
+			sprite = &atlas->sprites[atlas->num_sprites++];
+			sprite->name = strdup(name);
+			sprite->page = page;
+			sprite->u0 = (float)x / page_w[page];
+			sprite->v0 = (float)y / page_h[page];
+			sprite->u1 = (float)(x + w) / page_w[page];
+			sprite->v1 = (float)(y + h) / page_h[page];
+
+		}
+
 	}
-	
-	fseek(fp, 0, SEEK_END);
-	file_len = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
 
-	source = (char*)malloc(file_len + 1);
-	fread(source, file_len, 1, fp);
 	fclose(fp);
-	source[file_len] = '\0';
+	free(page_w);
+	free(page_h);
 
-	const GLchar *sources[] = {
-		source
-	};
+	dash_resource_track(DASH_RESOURCE_MEMORY, (unsigned long)atlas,
+		sizeof(dash_atlas) + atlas->num_pages * sizeof(GLuint) +
+		max_sprites * sizeof(struct dash_atlas_sprite), filename);
+	return atlas;
 
-	GLuint shader = glCreateShader(type);
-	glShaderSource(shader, 1, sources, NULL);
-	glCompileShader(shader);
+}
 
-	free((void*)source);
+int dash_atlas_lookup(dash_atlas *atlas, const char *name, dash_uv_rect *rect) {
+
+	int low, high, mid, cmp;
+	struct dash_atlas_sprite *sprite;
+
+	low = 0;
+	high = atlas->num_sprites - 1;
+	while(low <= high) {
+		mid = (low + high) / 2;
+		sprite = &atlas->sprites[mid];
+		cmp = strcmp(name, sprite->name);
+		if(cmp == 0) {
+			rect->texture = atlas->textures[sprite->page];
+			rect->u0 = sprite->u0;
+			rect->v0 = sprite->v0;
+			rect->u1 = sprite->u1;
+			rect->v1 = sprite->v1;
+			return 1;
+		}
+		if(cmp < 0) {
+			high = mid - 1;
+		} else {
+			low = mid + 1;
+		}
+	}
 
-	GLint compile_ok;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_ok);
-	if(compile_ok == GL_FALSE) {
-		fprintf(stderr, "%s: ", filename);
-		dash_print_log(shader);
-		glDeleteShader(shader);
-		return 0;
+	return 0;
+
+}
+
+void dash_atlas_free(dash_atlas *atlas) {
+
+	int i;
+
+	if(atlas == NULL) {
+		return;
 	}
 
-	return shader;
+	for(i = 0; i < atlas->num_pages; i++) {
+		dash_delete_texture(atlas->textures[i]);
+	}
+	dash_resource_untrack(DASH_RESOURCE_MEMORY, (unsigned long)atlas);
+	for(i = 0; i < atlas->num_sprites; i++) {
+		free(atlas->sprites[i].name);
+	}
+	free(atlas->sprites);
+	free(atlas->textures);
+	free(atlas);
 
 }
 
-GLuint dash_create_program(const char *vertex, const char *fragment) {
+/******************************************************************************/
+/** GPU Timer                                                                **/
+/******************************************************************************/
 
-	GLuint vs = dash_create_shader(vertex, GL_VERTEX_SHADER);
-	GLuint fs = dash_create_shader(fragment, GL_FRAGMENT_SHADER);
-	if(vs == 0 || fs == 0) {
-		return 0;
+/*
+ * GL_TIME_ELAPSED queries are kept in a small ring and only read back
+ * once GL_QUERY_RESULT_AVAILABLE says so, a few frames later, so timing
+ * the GPU never stalls the CPU waiting on it.
+ */
+
+#define DASH_GPU_QUERIES 4
+
+struct {
+	int supported;
+	GLuint queries[DASH_GPU_QUERIES];
+	int issued[DASH_GPU_QUERIES];
+	int current;
+	float last_ms;
+} gpu_timer = { -1 };
+
+static int dash_gpu_timer_init() {
+
+	if(gpu_timer.supported == -1) {
+		gpu_timer.supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+		if(gpu_timer.supported) {
+			glGenQueries(DASH_GPU_QUERIES, gpu_timer.queries);
+		}
+		gpu_timer.last_ms = -1.0f;
 	}
-	
-	GLint link_ok;
-	
-	GLuint program = glCreateProgram();
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
-	glGetProgramiv(program, GL_LINK_STATUS, &link_ok);
-	if(!link_ok) {
-		fprintf(stderr, "Program Link Error: ");
-		dash_print_log(program);
-		return 0;
+	return gpu_timer.supported;
+
+}
+
+void dash_gpu_timer_begin() {
+
+	GLuint query;
+	GLint available;
+	GLuint64 elapsed;
+	int slot;
+
+	if(!dash_gpu_timer_init()) {
+		return;
+	}
+
+	slot = gpu_timer.current;
+	query = gpu_timer.queries[slot];
+
+	// The slot about to be reused holds the oldest result
+	if(gpu_timer.issued[slot]) {
+		available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if(available) {
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			gpu_timer.last_ms = elapsed / 1e6f;
+		}
 	}
-	
-	return program;
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	gpu_timer.issued[slot] = 1;
 
 }
 
+void dash_gpu_timer_end() {
 
+	if(!dash_gpu_timer_init()) {
+		return;
+	}
 
+	glEndQuery(GL_TIME_ELAPSED);
+	gpu_timer.current = (gpu_timer.current + 1) % DASH_GPU_QUERIES;
 
-GLuint dash_texture_load(const char *filename) {
+}
 
-	FILE *fp;
-	
-	GLuint texture_id;
-	png_structp png_ptr;
-    png_infop info_ptr;
-	int width, height, bit_depth;
-	unsigned char *data;
-	int color_type, num_passes, y, x, i;
-	char header[8];
-	png_bytep *rows;
+float dash_gpu_timer_ms() {
 
-	fp = fopen(filename, "rb");
-	if(fp == NULL) {
-		fprintf(stderr, "Could not open %s for reading\n", filename);
-		exit(1);
+	return gpu_timer.last_ms;
+
+}
+
+/******************************************************************************/
+/** HUD Utils                                                                **/
+/******************************************************************************/
+
+/*
+ * The overlay is drawn from a 128x64 glyph texture with one 8x8 cell per
+ * ASCII code. Cell 0 is solid and is used for the panel and graph bars,
+ * so text and graph come out of the same texture. Every quad is written
+ * into one vertex array each frame and the whole overlay is a single
+ * glDrawArrays call.
+ */
+
+#define DASH_HUD_SAMPLES 120
+#define DASH_HUD_MAX_QUADS 1024
+#define DASH_HUD_SCALE 2.0f
+
+// 5x7 glyphs, one byte per row, bit 4 is the leftmost column
+static const unsigned char dash_hud_font[][8] = {
+	{ '0', 0x0E,0x11,0x13,0x15,0x19,0x11,0x0E },
+	{ '1', 0x04,0x0C,0x04,0x04,0x04,0x04,0x0E },
+	{ '2', 0x0E,0x11,0x01,0x02,0x04,0x08,0x1F },
+	{ '3', 0x1F,0x02,0x04,0x02,0x01,0x11,0x0E },
+	{ '4', 0x02,0x06,0x0A,0x12,0x1F,0x02,0x02 },
+	{ '5', 0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E },
+	{ '6', 0x06,0x08,0x10,0x1E,0x11,0x11,0x0E },
+	{ '7', 0x1F,0x01,0x02,0x04,0x08,0x08,0x08 },
+	{ '8', 0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E },
+	{ '9', 0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C },
+	{ 'A', 0x0E,0x11,0x11,0x11,0x1F,0x11,0x11 },
+	{ 'B', 0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E },
+	{ 'C', 0x0E,0x11,0x10,0x10,0x10,0x11,0x0E },
+	{ 'D', 0x1C,0x12,0x11,0x11,0x11,0x12,0x1C },
+	{ 'E', 0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F },
+	{ 'F', 0x1F,0x10,0x10,0x1E,0x10,0x10,0x10 },
+	{ 'G', 0x0E,0x11,0x10,0x17,0x11,0x11,0x0F },
+	{ 'H', 0x11,0x11,0x11,0x1F,0x11,0x11,0x11 },
+	{ 'I', 0x0E,0x04,0x04,0x04,0x04,0x04,0x0E },
+	{ 'J', 0x07,0x02,0x02,0x02,0x02,0x12,0x0C },
+	{ 'K', 0x11,0x12,0x14,0x18,0x14,0x12,0x11 },
+	{ 'L', 0x10,0x10,0x10,0x10,0x10,0x10,0x1F },
+	{ 'M', 0x11,0x1B,0x15,0x15,0x11,0x11,0x11 },
+	{ 'N', 0x11,0x11,0x19,0x15,0x13,0x11,0x11 },
+	{ 'O', 0x0E,0x11,0x11,0x11,0x11,0x11,0x0E },
+	{ 'P', 0x1E,0x11,0x11,0x1E,0x10,0x10,0x10 },
+	{ 'Q', 0x0E,0x11,0x11,0x11,0x15,0x12,0x0D },
+	{ 'R', 0x1E,0x11,0x11,0x1E,0x14,0x12,0x11 },
+	{ 'S', 0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E },
+	{ 'T', 0x1F,0x04,0x04,0x04,0x04,0x04,0x04 },
+	{ 'U', 0x11,0x11,0x11,0x11,0x11,0x11,0x0E },
+	{ 'V', 0x11,0x11,0x11,0x11,0x11,0x0A,0x04 },
+	{ 'W', 0x11,0x11,0x11,0x15,0x15,0x15,0x0A },
+	{ 'X', 0x11,0x11,0x0A,0x04,0x0A,0x11,0x11 },
+	{ 'Y', 0x11,0x11,0x11,0x0A,0x04,0x04,0x04 },
+	{ 'Z', 0x1F,0x01,0x02,0x04,0x08,0x10,0x1F },
+	{ '.', 0x00,0x00,0x00,0x00,0x00,0x0C,0x0C },
+	{ ':', 0x00,0x0C,0x0C,0x00,0x0C,0x0C,0x00 },
+	{ '/', 0x00,0x01,0x02,0x04,0x08,0x10,0x00 },
+	{ '%', 0x18,0x19,0x02,0x04,0x08,0x13,0x03 },
+	{ '-', 0x00,0x00,0x00,0x1F,0x00,0x00,0x00 },
+	{ 0 }
+};
+
+struct {
+	int ready;
+	int visible;
+	GLuint program;
+	GLuint texture;
+	GLuint vbo;
+	GLint attribute_coord2d;
+	GLint attribute_uv;
+	GLint attribute_color;
+	GLint uniform_ortho;
+	GLint uniform_glyphs;
+	float frame_ms[DASH_HUD_SAMPLES];
+	int sample;
+	int ticks;
+	int draw_calls;
+	float gpu_ms;
+	float fps;
+	float fps_time;
+	int fps_frames;
+	float *vertices;
+	int num_quads;
+} hud;
+
+static void dash_hud_quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, const float *color) {
+
+	float *v;
+	int i;
+	float corners[6][4] = {
+		{ x0, y0, u0, v1 },
+		{ x0, y1, u0, v0 },
+		{ x1, y1, u1, v0 },
+		{ x1, y1, u1, v0 },
+		{ x1, y0, u1, v1 },
+		{ x0, y0, u0, v1 }
+	};
+
+	if(hud.num_quads == DASH_HUD_MAX_QUADS) {
+		return;
 	}
 
-	if(fread(header, 1, 8, fp) <= 0) {
-		fprintf(stderr, "Could not read png header\n");
-		exit(1);
+	v = hud.vertices + hud.num_quads * 6 * 8;
+	for(i = 0; i < 6; i++) {
+		v[0] = corners[i][0];
+		v[1] = corners[i][1];
+		v[2] = corners[i][2];
+		v[3] = corners[i][3];
+		v[4] = color[0];
+		v[5] = color[1];
+		v[6] = color[2];
+		v[7] = color[3];
+		v += 8;
 	}
+	hud.num_quads++;
 
-	if (png_sig_cmp(header, 0, 8)) {
-		fprintf(stderr, "%s is not a valid png file\n", filename);
-		exit(1);
+}
+
+static void dash_hud_solid(float x0, float y0, float x1, float y1, const float *color) {
+
+	// Sample the middle of the solid cell so no filtering reaches its edge
+	dash_hud_quad(x0, y0, x1, y1, 4.0f / 128.0f, 4.0f / 64.0f, 4.0f / 128.0f, 4.0f / 64.0f, color);
+
+}
 
+static void dash_hud_text(float x, float y, const char *text, const float *color) {
+
+	float u, v, w, h;
+	int c;
+
+	w = 6.0f * DASH_HUD_SCALE;
+	h = 8.0f * DASH_HUD_SCALE;
+
+	for(; *text; text++, x += w) {
+		c = *text;
+		if(c >= 'a' && c <= 'z') {
+			c -= 'a' - 'A';
+		}
+		if(c <= ' ' || c > 127) {
+			continue;
+		}
+		u = (c % 16) * 8.0f / 128.0f;
+		v = (c / 16) * 8.0f / 64.0f;
+		dash_hud_quad(x, y - h, x + w, y, u, v, u + 6.0f / 128.0f, v + 8.0f / 64.0f, color);
 	}
 
-	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+}
 
-    if (png_ptr == NULL) {
-        fclose(fp);
-        return 0;
-    }
-
-    info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == NULL) {
-        fclose(fp);
-        png_destroy_read_struct(&png_ptr, NULL, NULL);
-        return 0;
-    }
-
-    if (setjmp(png_jmpbuf(png_ptr))) {
-        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-        fclose(fp);
-        return 0;
-    }
-
-    png_init_io(png_ptr, fp);
-	png_set_sig_bytes(png_ptr, 8);
-	png_read_info(png_ptr, info_ptr);
+int dash_hud_init(const char *vertex, const char *fragment) {
 
-	width = png_get_image_width(png_ptr, info_ptr);
-	height = png_get_image_height(png_ptr, info_ptr);
-	
-	color_type = png_get_color_type(png_ptr, info_ptr);
-	bit_depth  = png_get_bit_depth(png_ptr, info_ptr);
+	unsigned char pixels[64][128][4];
+	int i, row, col, cx, cy;
 
-	num_passes = png_set_interlace_handling(png_ptr);
-	png_read_update_info(png_ptr, info_ptr);
+	memset(pixels, 0, sizeof(pixels));
 
-	switch(color_type) {
-		case 0:
-			printf("grayscale\n");
-			exit(1);
-		break;
-		case PNG_COLOR_TYPE_RGB:
-			bit_depth = GL_RGB;
-			color_type = 3;
-			data = (unsigned char*)malloc(3 * width * height);
-		break;
-		case 3:
-			printf("pallete look up table\n");
-			exit(1);
-		break;
-		case 4:
-			printf("grayscale with alpha\n");
-			exit(1);
-		break;
-		case PNG_COLOR_TYPE_RGBA:
-			bit_depth = GL_RGBA;
-			color_type = 4;
-			printf("RGBA\n");
-			data = (unsigned char*)malloc(4 * width * height);
-		break;
-	}
-
-    if (setjmp(png_jmpbuf(png_ptr))) {
-        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-        fclose(fp);
-        return 0;
-    }
-	
-	rows = (png_bytep*) malloc(sizeof(png_bytep) * height);
-	for (y = 0; y < height; y++) {
-		rows[y] = (png_byte*) malloc(png_get_rowbytes(png_ptr, info_ptr));
+	// Cell 0: solid
+	for(row = 0; row < 8; row++) {
+		for(col = 0; col < 8; col++) {
+			memset(pixels[row][col], 255, 4);
+		}
 	}
-	
-	png_read_image(png_ptr, rows);
-	fclose(fp);
 
-	i = 0;
-	for(y = 0; y < height; y++) {
-		memcpy((void*)&data[y*width*color_type], (void*)rows[y], width * color_type);
-		png_free(png_ptr, rows[y]);
+	for(i = 0; dash_hud_font[i][0]; i++) {
+		cx = (dash_hud_font[i][0] % 16) * 8;
+		cy = (dash_hud_font[i][0] / 16) * 8;
+		for(row = 0; row < 7; row++) {
+			for(col = 0; col < 5; col++) {
+				if(dash_hud_font[i][row + 1] & (0x10 >> col)) {
+					memset(pixels[cy + row][cx + col], 255, 4);
+				}
+			}
+		}
 	}
-	
-	png_free(png_ptr, rows);
-	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 
-    glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D,
-        0,
-        bit_depth,
-        width,
-        height,
-        0,
-        bit_depth,
-        GL_UNSIGNED_BYTE,
-        data
-    );
-	free(data);
+	hud.program = dash_create_program(vertex, fragment);
+	if(hud.program == 0) {
+		fprintf(stderr, "HUD program creation error\n");
+		return -1;
+	}
 
-	return texture_id;
+	hud.attribute_coord2d = glGetAttribLocation(hud.program, "coord2d");
+	hud.attribute_uv = glGetAttribLocation(hud.program, "uv");
+	hud.attribute_color = glGetAttribLocation(hud.program, "color");
+	hud.uniform_ortho = glGetUniformLocation(hud.program, "ortho");
+	hud.uniform_glyphs = glGetUniformLocation(hud.program, "glyphs");
+	if(
+		hud.attribute_coord2d == -1 || hud.attribute_uv == -1 ||
+		hud.attribute_color == -1 || hud.uniform_ortho == -1
+	) {
+		fprintf(stderr, "Could not bind HUD attributes\n");
+		dash_delete_program(hud.program);
+		return -1;
+	}
+
+	glGenTextures(1, &hud.texture);
+	glBindTexture(GL_TEXTURE_2D, hud.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 128, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	dash_resource_track(DASH_RESOURCE_TEXTURE, hud.texture, sizeof(pixels), "hud glyphs");
+
+	glGenBuffers(1, &hud.vbo);
+	dash_resource_track(DASH_RESOURCE_BUFFER, hud.vbo, 0, "hud vertices");
+	hud.vertices = (float*)malloc(DASH_HUD_MAX_QUADS * 6 * 8 * sizeof(float));
+	dash_resource_track(DASH_RESOURCE_MEMORY, (unsigned long)hud.vertices,
+		DASH_HUD_MAX_QUADS * 6 * 8 * sizeof(float), "hud vertices");
+	hud.ready = 1;
+
+	return 0;
+
+}
+
+void dash_hud_shutdown() {
+
+	if(!hud.ready) {
+		return;
+	}
+
+	dash_delete_program(hud.program);
+	dash_delete_texture(hud.texture);
+	dash_delete_buffer(hud.vbo);
+	dash_resource_untrack(DASH_RESOURCE_MEMORY, (unsigned long)hud.vertices);
+	free(hud.vertices);
+	hud.vertices = NULL;
+	hud.ready = 0;
+
+}
+
+void dash_hud_toggle() {
+
+	hud.visible = !hud.visible;
+
+}
+
+int dash_hud_visible() {
+
+	return hud.visible;
+
+}
+
+void dash_hud_frame(float frame_ms, int ticks, int draw_calls, float gpu_ms) {
+
+	hud.frame_ms[hud.sample] = frame_ms;
+	hud.sample = (hud.sample + 1) % DASH_HUD_SAMPLES;
+	hud.ticks = ticks;
+	hud.draw_calls = draw_calls;
+	hud.gpu_ms = gpu_ms;
+
+	// Average over about half a second so the number stays readable
+	hud.fps_time += frame_ms;
+	hud.fps_frames++;
+	if(hud.fps_time >= 500.0f) {
+		hud.fps = hud.fps_frames * 1000.0f / hud.fps_time;
+		hud.fps_time = 0.0f;
+		hud.fps_frames = 0;
+	}
+
+}
+
+void dash_hud_draw(float width, float height) {
+
+	static const float panel[4] = { 0.0f, 0.0f, 0.0f, 0.6f };
+	static const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	static const float good[4] = { 0.2f, 0.9f, 0.2f, 1.0f };
+	static const float slow[4] = { 0.9f, 0.9f, 0.2f, 1.0f };
+	static const float bad[4] = { 0.9f, 0.2f, 0.2f, 1.0f };
+	const float *color;
+	char line[64];
+	float x, y, line_h, graph_h, bar_w, ms, bar;
+	int i, index;
+	mat4 ortho;
+
+	if(!hud.ready || !hud.visible) {
+		return;
+	}
+
+	hud.num_quads = 0;
+	line_h = 9.0f * DASH_HUD_SCALE;
+	graph_h = 40.0f;
+	bar_w = 2.0f;
+	x = 8.0f;
+	y = height - 8.0f;
+
+	dash_hud_solid(0.0f, height - 4 * line_h - graph_h - 20.0f,
+		DASH_HUD_SAMPLES * bar_w + 16.0f, height, panel);
+
+	ms = hud.frame_ms[(hud.sample + DASH_HUD_SAMPLES - 1) % DASH_HUD_SAMPLES];
+	snprintf(line, sizeof(line), "FPS %.1f  %.2f MS", hud.fps, ms);
+	dash_hud_text(x, y, line, white);
+	y -= line_h;
+
+	snprintf(line, sizeof(line), "TICKS/FRAME %d", hud.ticks);
+	dash_hud_text(x, y, line, white);
+	y -= line_h;
+
+	snprintf(line, sizeof(line), "DRAWS %d", hud.draw_calls);
+	dash_hud_text(x, y, line, white);
+	y -= line_h;
+
+	if(hud.gpu_ms >= 0.0f) {
+		snprintf(line, sizeof(line), "GPU %.2f MS", hud.gpu_ms);
+	} else {
+		snprintf(line, sizeof(line), "GPU N/A");
+	}
+	dash_hud_text(x, y, line, white);
+	y -= line_h + 4.0f;
+
+	// Frame time graph, oldest on the left, full height at 33 ms
+	for(i = 0; i < DASH_HUD_SAMPLES; i++) {
+		index = (hud.sample + i) % DASH_HUD_SAMPLES;
+		ms = hud.frame_ms[index];
+		color = ms < 17.0f ? good : ms < 34.0f ? slow : bad;
+		bar = ms / 33.3f * graph_h;
+		if(bar > graph_h) {
+			bar = graph_h;
+		}
+		dash_hud_solid(x + i * bar_w, y - graph_h, x + i * bar_w + bar_w - 0.5f,
+			y - graph_h + bar, color);
+	}
+
+	mat4_orthographic(0, width, height, 0, ortho);
+
+	dash_use_program(hud.program);
+	dash_uniform_matrix4fv(hud.uniform_ortho, ortho);
+	dash_uniform1i(hud.uniform_glyphs, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, hud.texture);
+
+	dash_bind_buffer(GL_ARRAY_BUFFER, hud.vbo);
+	glBufferData(GL_ARRAY_BUFFER, hud.num_quads * 6 * 8 * sizeof(float), NULL, GL_STREAM_DRAW);
+	dash_resource_resize(DASH_RESOURCE_BUFFER, hud.vbo, hud.num_quads * 6 * 8 * sizeof(float));
+	glBufferSubData(GL_ARRAY_BUFFER, 0, hud.num_quads * 6 * 8 * sizeof(float), hud.vertices);
+
+	dash_enable_attrib(hud.attribute_coord2d);
+	dash_enable_attrib(hud.attribute_uv);
+	dash_enable_attrib(hud.attribute_color);
+	dash_attrib_pointer(hud.attribute_coord2d, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+	dash_attrib_pointer(hud.attribute_uv, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(2 * sizeof(float)));
+	dash_attrib_pointer(hud.attribute_color, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArrays(GL_TRIANGLES, 0, hud.num_quads * 6);
+	glDisable(GL_BLEND);
+
+	dash_disable_attrib(hud.attribute_coord2d);
+	dash_disable_attrib(hud.attribute_uv);
+	dash_disable_attrib(hud.attribute_color);
 
 }
 
@@ -486,7 +3285,6 @@ void mat4_rotate(vec3 r, mat4 m) {
 
 void mat4_look_at(vec3 eye, vec3 center, vec3 up, mat4 m) {
 	
-	mat4 a;
 	vec3 f, s, t;
 	
 	vec3_subtract(center, eye, f);
@@ -512,17 +3310,13 @@ void mat4_look_at(vec3 eye, vec3 center, vec3 up, mat4 m) {
 	m[10] = -f[2];
 	m[11] = 0.0f;
 
-	m[12] = 0.0f;
-	m[13] = 0.0f;
-	m[14] = 0.0f;
-	m[15] = 1.0f;
-
-	eye[0] = -eye[0];
-	eye[1] = -eye[1];
-	eye[2] = -eye[2];
+	// Translation is the rotation applied to -eye, written out directly
+	// so eye is left untouched and no full multiply is needed
 
-	mat4_translate(eye, a);
-	mat4_multiply(m, a, m);
+	m[12] = -(s[0]*eye[0] + s[1]*eye[1] + s[2]*eye[2]);
+	m[13] = -(t[0]*eye[0] + t[1]*eye[1] + t[2]*eye[2]);
+	m[14] =  (f[0]*eye[0] + f[1]*eye[1] + f[2]*eye[2]);
+	m[15] = 1.0f;
 
 }
 
@@ -592,6 +3386,179 @@ void mat4_orthographic(float left, float right, float top, float bottom, mat4 m)
 
 }
 
+void mat4_transpose(mat4 a, mat4 m) {
+
+	mat4 tmp;
+
+	tmp[M_00] = a[M_00];
+	tmp[M_01] = a[M_10];
+	tmp[M_02] = a[M_20];
+	tmp[M_03] = a[M_30];
+	tmp[M_10] = a[M_01];
+	tmp[M_11] = a[M_11];
+	tmp[M_12] = a[M_21];
+	tmp[M_13] = a[M_31];
+	tmp[M_20] = a[M_02];
+	tmp[M_21] = a[M_12];
+	tmp[M_22] = a[M_22];
+	tmp[M_23] = a[M_32];
+	tmp[M_30] = a[M_03];
+	tmp[M_31] = a[M_13];
+	tmp[M_32] = a[M_23];
+	tmp[M_33] = a[M_33];
+
+	mat4_copy(tmp, m);
+
+}
+
+int mat4_inverse(mat4 a, mat4 m) {
+
+	mat4 tmp;
+	float s0, s1, s2, s3, s4, s5;
+	float c0, c1, c2, c3, c4, c5;
+	float det, inv_det;
+	int i;
+
+	// Laplace expansion over 2x2 sub-determinants of the top and
+	// bottom row pairs, shared between all sixteen cofactors
+
+	s0 = a[M_00]*a[M_11] - a[M_10]*a[M_01];
+	s1 = a[M_00]*a[M_12] - a[M_10]*a[M_02];
+	s2 = a[M_00]*a[M_13] - a[M_10]*a[M_03];
+	s3 = a[M_01]*a[M_12] - a[M_11]*a[M_02];
+	s4 = a[M_01]*a[M_13] - a[M_11]*a[M_03];
+	s5 = a[M_02]*a[M_13] - a[M_12]*a[M_03];
+
+	c5 = a[M_22]*a[M_33] - a[M_32]*a[M_23];
+	c4 = a[M_21]*a[M_33] - a[M_31]*a[M_23];
+	c3 = a[M_21]*a[M_32] - a[M_31]*a[M_22];
+	c2 = a[M_20]*a[M_33] - a[M_30]*a[M_23];
+	c1 = a[M_20]*a[M_32] - a[M_30]*a[M_22];
+	c0 = a[M_20]*a[M_31] - a[M_30]*a[M_21];
+
+	det = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+	if(det == 0.0f) {
+		return 0;
+	}
+	inv_det = 1.0f / det;
+
+	tmp[M_00] =  a[M_11]*c5 - a[M_12]*c4 + a[M_13]*c3;
+	tmp[M_01] = -a[M_01]*c5 + a[M_02]*c4 - a[M_03]*c3;
+	tmp[M_02] =  a[M_31]*s5 - a[M_32]*s4 + a[M_33]*s3;
+	tmp[M_03] = -a[M_21]*s5 + a[M_22]*s4 - a[M_23]*s3;
+
+	tmp[M_10] = -a[M_10]*c5 + a[M_12]*c2 - a[M_13]*c1;
+	tmp[M_11] =  a[M_00]*c5 - a[M_02]*c2 + a[M_03]*c1;
+	tmp[M_12] = -a[M_30]*s5 + a[M_32]*s2 - a[M_33]*s1;
+	tmp[M_13] =  a[M_20]*s5 - a[M_22]*s2 + a[M_23]*s1;
+
+	tmp[M_20] =  a[M_10]*c4 - a[M_11]*c2 + a[M_13]*c0;
+	tmp[M_21] = -a[M_00]*c4 + a[M_01]*c2 - a[M_03]*c0;
+	tmp[M_22] =  a[M_30]*s4 - a[M_31]*s2 + a[M_33]*s0;
+	tmp[M_23] = -a[M_20]*s4 + a[M_21]*s2 - a[M_23]*s0;
+
+	tmp[M_30] = -a[M_10]*c3 + a[M_11]*c1 - a[M_12]*c0;
+	tmp[M_31] =  a[M_00]*c3 - a[M_01]*c1 + a[M_02]*c0;
+	tmp[M_32] = -a[M_30]*s3 + a[M_31]*s1 - a[M_32]*s0;
+	tmp[M_33] =  a[M_20]*s3 - a[M_21]*s1 + a[M_22]*s0;
+
+	for(i = 0; i < 16; i++) {
+		m[i] = tmp[i] * inv_det;
+	}
+
+	return 1;
+
+}
+
+int mat4_inverse_affine(mat4 a, mat4 m) {
+
+	mat4 tmp;
+	float det, inv_det;
+
+	// Only valid when the bottom row is (0, 0, 0, 1): invert the upper
+	// 3x3 by cofactors and rotate the negated translation through it
+
+	tmp[M_00] = a[M_11]*a[M_22] - a[M_12]*a[M_21];
+	tmp[M_10] = a[M_12]*a[M_20] - a[M_10]*a[M_22];
+	tmp[M_20] = a[M_10]*a[M_21] - a[M_11]*a[M_20];
+
+	det = a[M_00]*tmp[M_00] + a[M_01]*tmp[M_10] + a[M_02]*tmp[M_20];
+	if(det == 0.0f) {
+		return 0;
+	}
+	inv_det = 1.0f / det;
+
+	tmp[M_00] *= inv_det;
+	tmp[M_10] *= inv_det;
+	tmp[M_20] *= inv_det;
+
+	tmp[M_01] = (a[M_02]*a[M_21] - a[M_01]*a[M_22]) * inv_det;
+	tmp[M_11] = (a[M_00]*a[M_22] - a[M_02]*a[M_20]) * inv_det;
+	tmp[M_21] = (a[M_01]*a[M_20] - a[M_00]*a[M_21]) * inv_det;
+
+	tmp[M_02] = (a[M_01]*a[M_12] - a[M_02]*a[M_11]) * inv_det;
+	tmp[M_12] = (a[M_02]*a[M_10] - a[M_00]*a[M_12]) * inv_det;
+	tmp[M_22] = (a[M_00]*a[M_11] - a[M_01]*a[M_10]) * inv_det;
+
+	tmp[M_03] = -(tmp[M_00]*a[M_03] + tmp[M_01]*a[M_13] + tmp[M_02]*a[M_23]);
+	tmp[M_13] = -(tmp[M_10]*a[M_03] + tmp[M_11]*a[M_13] + tmp[M_12]*a[M_23]);
+	tmp[M_23] = -(tmp[M_20]*a[M_03] + tmp[M_21]*a[M_13] + tmp[M_22]*a[M_23]);
+
+	tmp[M_30] = 0.0f;
+	tmp[M_31] = 0.0f;
+	tmp[M_32] = 0.0f;
+	tmp[M_33] = 1.0f;
+
+	mat4_copy(tmp, m);
+	return 1;
+
+}
+
+int mat4_normal(mat4 a, mat4 m) {
+
+	mat4 tmp;
+	float det, inv_det;
+	int i;
+
+	// Inverse transpose of the upper 3x3, which is its cofactor
+	// matrix divided by the determinant
+
+	tmp[M_00] = a[M_11]*a[M_22] - a[M_12]*a[M_21];
+	tmp[M_01] = a[M_12]*a[M_20] - a[M_10]*a[M_22];
+	tmp[M_02] = a[M_10]*a[M_21] - a[M_11]*a[M_20];
+
+	det = a[M_00]*tmp[M_00] + a[M_01]*tmp[M_01] + a[M_02]*tmp[M_02];
+	if(det == 0.0f) {
+		return 0;
+	}
+	inv_det = 1.0f / det;
+
+	tmp[M_10] = a[M_02]*a[M_21] - a[M_01]*a[M_22];
+	tmp[M_11] = a[M_00]*a[M_22] - a[M_02]*a[M_20];
+	tmp[M_12] = a[M_01]*a[M_20] - a[M_00]*a[M_21];
+
+	tmp[M_20] = a[M_01]*a[M_12] - a[M_02]*a[M_11];
+	tmp[M_21] = a[M_02]*a[M_10] - a[M_00]*a[M_12];
+	tmp[M_22] = a[M_00]*a[M_11] - a[M_01]*a[M_10];
+
+	for(i = 0; i < 3; i++) {
+		m[M_00 + i] = tmp[M_00 + i] * inv_det;
+		m[M_01 + i] = tmp[M_01 + i] * inv_det;
+		m[M_02 + i] = tmp[M_02 + i] * inv_det;
+	}
+
+	m[M_30] = 0.0f;
+	m[M_31] = 0.0f;
+	m[M_32] = 0.0f;
+	m[M_03] = 0.0f;
+	m[M_13] = 0.0f;
+	m[M_23] = 0.0f;
+	m[M_33] = 1.0f;
+
+	return 1;
+
+}
+
 /******************************************************************************/
 /** End Program	                                                             **/
 /******************************************************************************/
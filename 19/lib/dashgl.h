@@ -31,6 +31,40 @@
 	typedef float mat4[16];
 	typedef float vec3[3];
 
+	struct dash_asset {
+		const char *name;
+		const unsigned char *data;
+		long size;
+	};
+
+	typedef struct dash_program_job dash_program_job;
+	typedef struct dash_atlas dash_atlas;
+
+	typedef struct {
+		GLuint texture;
+		float u0, v0, u1, v1;
+	} dash_uv_rect;
+
+	#define DASH_DTX_MAGIC 0x31585444
+	#define DASH_DTX_MAX_LEVELS 16
+
+	struct dash_dtx_level {
+		unsigned int offset;
+		unsigned int size;
+		unsigned int width;
+		unsigned int height;
+	};
+
+	struct dash_dtx_header {
+		unsigned int magic;
+		unsigned int format;
+		unsigned int width;
+		unsigned int height;
+		unsigned int num_levels;
+		unsigned int reserved[3];
+		struct dash_dtx_level level[DASH_DTX_MAX_LEVELS];
+	};
+
 	/**********************************************************************/
 	/** Constants                                                        **/	
 	/**********************************************************************/
@@ -52,6 +86,132 @@
 	#define M_23 14
 	#define M_33 15
 
+	/**********************************************************************/
+	/** Profiler                                                         **/	
+	/**********************************************************************/
+
+	struct dash_zone {
+		const char *name;
+		unsigned long long start;
+	};
+
+	struct dash_zone dash_zone_begin(const char *name);
+	void dash_zone_end(struct dash_zone *zone);
+	void dash_profile_enable(int enable);
+	void dash_profile_thread_name(const char *name);
+	int dash_profile_dump(const char *filename);
+
+	// DASH_ZONE("name") times the rest of the enclosing block. Without
+	// -DDASH_PROFILE it expands to nothing and costs nothing.
+
+	#ifdef DASH_PROFILE
+		#define DASH_ZONE_JOIN(a, b) a##b
+		#define DASH_ZONE_VAR(line) DASH_ZONE_JOIN(dash_zone_, line)
+		#define DASH_ZONE(name) \
+			struct dash_zone DASH_ZONE_VAR(__LINE__) \
+			__attribute__((cleanup(dash_zone_end))) = dash_zone_begin(name)
+	#else
+		#define DASH_ZONE(name) ((void)0)
+	#endif
+
+	/**********************************************************************/
+	/** GL Call Statistics                                               **/	
+	/**********************************************************************/
+
+	enum dash_gl_call {
+		DASH_GL_CLEAR,
+		DASH_GL_BIND_BUFFER,
+		DASH_GL_BIND_VERTEX_ARRAY,
+		DASH_GL_BIND_TEXTURE,
+		DASH_GL_USE_PROGRAM,
+		DASH_GL_ENABLE_ATTRIB,
+		DASH_GL_DISABLE_ATTRIB,
+		DASH_GL_ATTRIB_POINTER,
+		DASH_GL_UNIFORM,
+		DASH_GL_BUFFER_DATA,
+		DASH_GL_BUFFER_SUB_DATA,
+		DASH_GL_DRAW_ARRAYS,
+		DASH_GL_DRAW_ARRAYS_INSTANCED,
+		DASH_GL_CALL_COUNT
+	};
+
+	struct dash_gl_stats {
+		unsigned int calls[DASH_GL_CALL_COUNT];
+		unsigned int total;
+		unsigned long vertices;
+	};
+
+	void dash_gl_stats_frame();
+	const struct dash_gl_stats *dash_gl_stats_last();
+	const char *dash_gl_stats_name(int call);
+	void dash_gl_stats_reset();
+	void dash_gl_stats_print(FILE *fp);
+
+	void dash_gl_count_clear(GLbitfield mask);
+	void dash_gl_count_bind_buffer(GLenum target, GLuint buffer);
+	void dash_gl_count_bind_vertex_array(GLuint array);
+	void dash_gl_count_bind_texture(GLenum target, GLuint texture);
+	void dash_gl_count_use_program(GLuint program);
+	void dash_gl_count_enable_attrib(GLuint index);
+	void dash_gl_count_disable_attrib(GLuint index);
+	void dash_gl_count_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+	void dash_gl_count_uniform1i(GLint location, GLint v0);
+	void dash_gl_count_uniform1f(GLint location, GLfloat v0);
+	void dash_gl_count_uniform3fv(GLint location, GLsizei count, const GLfloat *value);
+	void dash_gl_count_uniform4fv(GLint location, GLsizei count, const GLfloat *value);
+	void dash_gl_count_uniform_matrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+	void dash_gl_count_buffer_data(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+	void dash_gl_count_buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+	void dash_gl_count_draw_arrays(GLenum mode, GLint first, GLsizei count);
+	void dash_gl_count_draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+
+	/**********************************************************************/
+	/** State Cache                                                      **/	
+	/**********************************************************************/
+
+	void dash_state_reset();
+	void dash_state_counters(unsigned long *hits, unsigned long *misses);
+	void dash_bind_buffer(GLenum target, GLuint buffer);
+	void dash_bind_vertex_array(GLuint array);
+	void dash_use_program(GLuint program);
+	void dash_enable_attrib(GLuint index);
+	void dash_disable_attrib(GLuint index);
+	void dash_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+	void dash_uniform1i(GLint location, GLint value);
+	void dash_uniform3fv(GLint location, const GLfloat *value);
+	void dash_uniform4fv(GLint location, const GLfloat *value);
+	void dash_uniform_matrix4fv(GLint location, const GLfloat *value);
+
+	/**********************************************************************/
+	/** Resource Registry                                                **/	
+	/**********************************************************************/
+
+	enum dash_resource_type {
+		DASH_RESOURCE_BUFFER,
+		DASH_RESOURCE_TEXTURE,
+		DASH_RESOURCE_PROGRAM,
+		DASH_RESOURCE_MEMORY,
+		DASH_RESOURCE_TYPES
+	};
+
+	void dash_resource_track(int type, unsigned long id, long bytes, const char *tag);
+	void dash_resource_resize(int type, unsigned long id, long bytes);
+	void dash_resource_untrack(int type, unsigned long id);
+	void dash_resource_totals(int type, int *objects, long *live_bytes, long *peak_bytes);
+	void dash_resource_print(FILE *fp);
+	int dash_resource_leaks(FILE *fp);
+	GLuint dash_create_buffer(GLenum target, GLsizeiptr size, const void *data, GLenum usage, const char *tag);
+	void dash_delete_buffer(GLuint buffer);
+	void dash_delete_texture(GLuint texture);
+	void dash_delete_program(GLuint program);
+
+	/**********************************************************************/
+	/** Asset Utilities                                                  **/	
+	/**********************************************************************/
+
+	const unsigned char *dash_asset_find(const char *name, long *size);
+	FILE *dash_asset_open(const char *name);
+
 	/**********************************************************************/
 	/** Shader Utilities                                                 **/	
 	/**********************************************************************/
@@ -59,8 +219,45 @@
 	GLuint dash_create_shader(const char *filename, GLenum type);
 	void dash_print_log(GLuint object);
 	GLuint dash_create_program(const char *vertex, const char *fragment);
+	GLuint dash_create_program_source(const char *vs_source, const char *fs_source);
+	dash_program_job *dash_create_program_async(const char *vertex, const char *fragment);
+	dash_program_job *dash_create_program_source_async(const char *vs_source, const char *fs_source);
+	int dash_program_poll(dash_program_job *job, GLuint *program);
+	void dash_program_cancel(dash_program_job *job);
+	int dash_watch_shaders(const char *vertex, const char *fragment);
+	int dash_watch_changed(char **vs_source, char **fs_source);
+	
+	/**********************************************************************/
+	/** Texture Utilities                                                **/	
+	/**********************************************************************/
+
+	unsigned char *dash_png_read(const char *filename, int *width, int *height, GLenum *format);
 	GLuint dash_texture_load(const char *filename);
+	GLuint dash_texture_load_dtx(const char *filename);
+	int dash_stream_init(int workers, double budget_ms);
+	void dash_stream_budget(double budget_ms);
+	GLuint dash_stream_texture(const char *filename);
+	int dash_stream_resident(GLuint texture);
+	int dash_stream_update();
+	void dash_stream_shutdown();
+	dash_atlas *dash_atlas_load(const char *filename);
+	int dash_atlas_lookup(dash_atlas *atlas, const char *name, dash_uv_rect *rect);
+	void dash_atlas_free(dash_atlas *atlas);
 	
+	/**********************************************************************/
+	/** HUD Utilities                                                    **/	
+	/**********************************************************************/
+
+	void dash_gpu_timer_begin();
+	void dash_gpu_timer_end();
+	float dash_gpu_timer_ms();
+	int dash_hud_init(const char *vertex, const char *fragment);
+	void dash_hud_shutdown();
+	void dash_hud_toggle();
+	int dash_hud_visible();
+	void dash_hud_frame(float frame_ms, int ticks, int draw_calls, float gpu_ms);
+	void dash_hud_draw(float width, float height);
+
 	/**********************************************************************/
 	/** Vector3 Utilities                                                **/	
 	/**********************************************************************/
@@ -84,5 +281,55 @@
 	void mat4_look_at(vec3 eye, vec3 center, vec3 up, mat4 m);
 	void mat4_perspective(float y_fov, float aspect, float n, float f, mat4 m);
 	void mat4_orthographic(float left, float right, float top, float bottom, mat4 m);
+	void mat4_transpose(mat4 a, mat4 m);
+	int mat4_inverse(mat4 a, mat4 m);
+	int mat4_inverse_affine(mat4 a, mat4 m);
+	int mat4_normal(mat4 a, mat4 m);
+
+	/**********************************************************************/
+	/** GL Call Interception                                             **/	
+	/**********************************************************************/
+
+	// With -DDASH_GL_STATS the GL calls below, in every file including
+	// this header, go through the dash_gl_count_* wrappers. Without it
+	// nothing is redirected and the counters stay at zero.
+
+	#ifdef DASH_GL_STATS
+		#undef glClear
+		#undef glBindBuffer
+		#undef glBindVertexArray
+		#undef glBindTexture
+		#undef glUseProgram
+		#undef glEnableVertexAttribArray
+		#undef glDisableVertexAttribArray
+		#undef glVertexAttribPointer
+		#undef glUniform1i
+		#undef glUniform1f
+		#undef glUniform3fv
+		#undef glUniform4fv
+		#undef glUniformMatrix4fv
+		#undef glBufferData
+		#undef glBufferSubData
+		#undef glDrawArrays
+		#undef glDrawArraysInstanced
+
+		#define glClear(a) dash_gl_count_clear(a)
+		#define glBindBuffer(a, b) dash_gl_count_bind_buffer(a, b)
+		#define glBindVertexArray(a) dash_gl_count_bind_vertex_array(a)
+		#define glBindTexture(a, b) dash_gl_count_bind_texture(a, b)
+		#define glUseProgram(a) dash_gl_count_use_program(a)
+		#define glEnableVertexAttribArray(a) dash_gl_count_enable_attrib(a)
+		#define glDisableVertexAttribArray(a) dash_gl_count_disable_attrib(a)
+		#define glVertexAttribPointer(a, b, c, d, e, f) dash_gl_count_attrib_pointer(a, b, c, d, e, f)
+		#define glUniform1i(a, b) dash_gl_count_uniform1i(a, b)
+		#define glUniform1f(a, b) dash_gl_count_uniform1f(a, b)
+		#define glUniform3fv(a, b, c) dash_gl_count_uniform3fv(a, b, c)
+		#define glUniform4fv(a, b, c) dash_gl_count_uniform4fv(a, b, c)
+		#define glUniformMatrix4fv(a, b, c, d) dash_gl_count_uniform_matrix4fv(a, b, c, d)
+		#define glBufferData(a, b, c, d) dash_gl_count_buffer_data(a, b, c, d)
+		#define glBufferSubData(a, b, c, d) dash_gl_count_buffer_sub_data(a, b, c, d)
+		#define glDrawArrays(a, b, c) dash_gl_count_draw_arrays(a, b, c)
+		#define glDrawArraysInstanced(a, b, c, d) dash_gl_count_draw_arrays_instanced(a, b, c, d)
+	#endif
 
 #endif
@@ -17,64 +17,130 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <GL/glew.h>
 #include <gtk/gtk.h>
 #include "lib/dashgl.h"
+#include "level.h"
+#include "world.h"
+#include "particles.h"
+#include "game.h"
+#include "session.h"
 
 static void on_realize(GtkGLArea *area);
+static void on_unrealize(GtkGLArea *area);
 static void on_render(GtkGLArea *area, GdkGLContext *conext);
 static gboolean on_idle(gpointer data);
 static gint on_destroy(GtkWidget *widget);
 static gboolean on_keydown(GtkWidget *widget, GdkEventKey *event);
 static gboolean on_keyup(GtkWidget *widget, GdkEventKey *event);
+static int load_game();
+static int bind_program();
+static void poll_program();
+static void latency_input();
+static void latency_tick();
+static void latency_render();
+static void latch_paddle(gint64 now, vec3 pos);
+static void latch_start();
+static gboolean on_frame_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data);
+static void latency_print();
 
 #define WIDTH 640.0f
 #define HEIGHT 480.0f
+#define TICK_MS 20
+
+// DASH_LEVEL picks the level: a .lvl file made by tools/levelc, or
+// COLSxROWS for a generated lattice. DASH_WORLD takes the same and
+// scrolls through it instead, streaming chunks under a cap of
+// DASH_WORLD_MB megabytes. DASH_BALLS=n plays with more than one ball.
+// DASH_RECORD=file saves the game as a session that bench/replay can
+// play back headless, see session.h. DASH_PARTICLES=n sizes the pool
+// for brick bursts, 0 turns them off. DASH_PARTICLE_MODE=instanced,
+// points or splat picks how they are drawn, see particles.h.
+
+struct game game;
+struct game_gfx gfx;
+struct world *world;
+struct particles *particles;
+struct particles_gfx particles_gfx;
+FILE *record;
 
 struct {
-	vec3 pos;
-	vec3 color;
-	GLuint vbo;
-	int segments;
-	float radius;
-	float dx;
-	float dy;
-} ball;
+	gint64 last_frame;
+	int ticks;
+	int draw_calls;
+} stats;
+
+// Competitive mode, toggled with F4 or started with DASH_LATE_LATCH=1.
+// Frames are drawn on every tick of the GdkFrameClock instead of after
+// each game tick, and on_render reads the key state as it is right then
+// and draws the paddle where the next tick will put it, scaled by how
+// much of the tick has passed. on_idle still moves the real paddle, so
+// collisions do not change, only what the player sees arrives up to a
+// tick earlier.
 
 struct {
-	vec3 pos;
-	vec3 color;
-	GLuint vbo;
-	int left_down;
-	int right_down;
-	float width;
-	float height;
-	float dx;
-} paddle;
+	int enabled;
+	guint frame_callback;
+	gint64 last_tick;
+} late_latch;
+
+// Key presses are followed through the tick that consumed them and the
+// frame that drew the result, up to that frame's presentation time from
+// the GdkFrameClock. Each stage goes into a histogram of 0.5 ms buckets.
+
+#define LATENCY_INFLIGHT 32
+#define LATENCY_BUCKETS 256
+
+enum {
+	LATENCY_INPUT,
+	LATENCY_TICKED,
+	LATENCY_RENDERED
+};
+
+struct latency_sample {
+	int stage;
+	gint64 input;
+	gint64 tick;
+	gint64 render;
+	gint64 frame;
+};
+
+struct latency_histogram {
+	unsigned int buckets[LATENCY_BUCKETS];
+	unsigned int count;
+	gint64 max;
+};
 
 struct {
-	vec3 pos[30];
-	int active[30];
-	vec3 color[6];
-	float width;
-	float height;
-	float x_padding;
-	float y_padding;
-	GLuint vbo;
-} bricks;
+	struct latency_sample pending[LATENCY_INFLIGHT];
+	int num_pending;
+	unsigned int dropped;
+	struct latency_histogram input_to_tick;
+	struct latency_histogram tick_to_render;
+	struct latency_histogram render_to_present;
+	struct latency_histogram total;
+} latency;
 
 int init = 0;
 GtkWidget *glArea;
 
 GLuint program;
-GLuint vao;
-GLint attribute_coord2d, uniform_diffuse, uniform_mvp;
+dash_program_job *program_job;
 
 int main(int argc, char *argv[]) {
 	
 	GtkWidget *window;
 
 	gtk_init(&argc, &argv);
+
+	// Built with make profile, DASH_TRACE=file.json records a trace
+	// that is written out when the window closes
+	dash_profile_enable(getenv("DASH_TRACE") != NULL);
+	dash_profile_thread_name("main");
+
+	late_latch.enabled = getenv("DASH_LATE_LATCH") != NULL;
 	
 	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
 	gtk_window_set_title(GTK_WINDOW(window), "DashGL - Brickout");
@@ -89,6 +155,7 @@ int main(int argc, char *argv[]) {
 	gtk_widget_set_vexpand(glArea, TRUE);
 	gtk_widget_set_hexpand(glArea, TRUE);
 	g_signal_connect(glArea, "realize", G_CALLBACK(on_realize), NULL);
+	g_signal_connect(glArea, "unrealize", G_CALLBACK(on_unrealize), NULL);
 	g_signal_connect(glArea, "render", G_CALLBACK(on_render), NULL);
 	gtk_container_add(GTK_CONTAINER(window), glArea);
 	
@@ -96,7 +163,10 @@ int main(int argc, char *argv[]) {
 	// g_signal_connect(G_OBJECT(glArea), "draw", G_CALLBACK(on_render), NULL);
 	//gtk_gl_area_set_auto_render(GTK_GL_AREA(glArea), TRUE);
 
-	g_timeout_add(20, on_idle, NULL);
+	g_timeout_add(TICK_MS, on_idle, NULL);
+	if(late_latch.enabled) {
+		latch_start();
+	}
 
 	gtk_widget_show_all(window);
 
@@ -106,10 +176,66 @@ int main(int argc, char *argv[]) {
 
 }
 
+static int load_game() {
+
+	const char *spec, *balls, *path, *cap, *pool;
+	struct level *level;
+	unsigned int seed;
+	int num_balls;
+
+	balls = getenv("DASH_BALLS");
+	num_balls = balls != NULL ? atoi(balls) : 1;
+	seed = time(NULL);
+
+	pool = getenv("DASH_PARTICLES");
+	if(pool == NULL || atoi(pool) > 0) {
+		particles = particles_create(pool ? atoi(pool) : 100000, seed);
+	}
+
+	spec = getenv("DASH_WORLD");
+	if(spec != NULL) {
+		cap = getenv("DASH_WORLD_MB");
+		world = world_open(spec, WIDTH, HEIGHT, (cap ? atol(cap) : 64) * 1024 * 1024);
+		if(world == NULL) {
+			return -1;
+		}
+		game_init(&game, NULL, num_balls, seed, WIDTH, HEIGHT);
+		game_set_world(&game, world);
+		game.particles = particles;
+		printf("World has %d rows in %d chunks, %d ball(s)\n",
+			world->rows, world->num_chunks, game.balls.count);
+		return 0;
+	}
+
+	spec = getenv("DASH_LEVEL");
+	if(spec == NULL) {
+		spec = "classic";
+	}
+
+	level = level_from_spec(spec, WIDTH, HEIGHT);
+	if(level == NULL) {
+		return -1;
+	}
+
+	game_init(&game, level, num_balls, seed, WIDTH, HEIGHT);
+	game.particles = particles;
+	printf("Level has %d bricks, %d ball(s)\n", level->count, game.balls.count);
+
+	path = getenv("DASH_RECORD");
+	if(path != NULL) {
+		record = session_record(path, spec, game.balls.count, seed);
+	}
+
+	return 0;
+
+}
+
 static void on_realize(GtkGLArea *area) {
 
-	int i, col, row;
-	float angle, nextAngle;
+	const char *name;
+	int mode;
+
+	DASH_ZONE("on_realize");
 
 	printf("Realize start\n");
 
@@ -130,401 +256,343 @@ static void on_realize(GtkGLArea *area) {
 	
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	if(load_game() != 0) {
+		exit(1);
+	}
+	game_gfx_init(&gfx, &game);
+	name = getenv("DASH_PARTICLE_MODE");
+	mode = name != NULL ? PARTICLES_SPLAT : PARTICLES_AUTO;
+	while(mode > PARTICLES_AUTO && strcmp(name, particles_mode_name(mode)) != 0) {
+		mode--;
+	}
+	if(particles && particles_gfx_init(&particles_gfx, particles, WIDTH, HEIGHT, mode) != 0) {
+		fprintf(stderr, "Particles are simulated but not drawn\n");
+	}
+
+	// The program finishes compiling in the background while on_render
+	// draws a placeholder, see poll_program()
 
-	srand(time(NULL));
+	program = 0;
+	program_job = dash_create_program_async("sdr/vertex.glsl", "sdr/fragment.glsl");
+	if(program_job == NULL) {
+		fprintf(stderr, "Program creation error\n");
+		exit(1);
+	}
 
-	ball.segments = 100;
-	ball.radius = 15.0f;
-	ball.pos[0] = 320.0f;
-	ball.pos[1] = 240.0f;
-	ball.pos[2] = 0.0f;
-	ball.dx = (rand() % 5) / 10.0f + 1.0f;
-	printf("%d\n", rand() % 10);
-	
-	if(rand() % 10 > 5) {
-		ball.dx = -ball.dx;
+	if(dash_watch_shaders("sdr/vertex.glsl", "sdr/fragment.glsl") != 0) {
+		fprintf(stderr, "Shader hot reload disabled\n");
 	}
 
-	ball.dy = -2.0f;
-	ball.color[0] = 1.0f;
-	ball.color[1] = 1.0f;
-	ball.color[2] = 1.0f;
+	// Performance overlay, toggled with F3
 
-	// Initialize Ball
+	if(dash_hud_init("sdr/hud_vertex.glsl", "sdr/hud_fragment.glsl") != 0) {
+		fprintf(stderr, "Performance HUD disabled\n");
+	}
 
-	GLfloat *triangle_vertices;
-	triangle_vertices = malloc(6 * ball.segments * sizeof(GLfloat));
-	
-	for(i = 0; i < ball.segments; i++) {
+	printf("On Realize end\n");
+
+}
 
-		angle = i * 2.0f * M_PI / (ball.segments - 1);	
-		nextAngle = (i+1) * 2.0f * M_PI / (ball.segments - 1);
+static void on_unrealize(GtkGLArea *area) {
 
-		triangle_vertices[i*6 + 0] = cos(angle) * ball.radius;
-		triangle_vertices[i*6 + 1] = sin(angle) * ball.radius;
-		
-		triangle_vertices[i*6 + 2] = cos(nextAngle) * ball.radius;
-		triangle_vertices[i*6 + 3] = sin(nextAngle) * ball.radius;
-	
-		triangle_vertices[i*6 + 4] = 0.0f;
-		triangle_vertices[i*6 + 5] = 0.0f;
+	int leaks;
 
+	// The context is still alive here, unlike in on_destroy
+
+	gtk_gl_area_make_current(area);
+	if(gtk_gl_area_get_error(area) != NULL) {
+		return;
 	}
 
-	glGenBuffers(1, &ball.vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, ball.vbo);
-	glBufferData(
-	    GL_ARRAY_BUFFER,
-	    6 * ball.segments * sizeof(GLfloat),
-	    triangle_vertices,
-	    GL_STATIC_DRAW
-	);
-	
-	free(triangle_vertices);
-
-	// Initialize Paddle
-
-	paddle.pos[0] = 320.0f;
-	paddle.pos[1] = 40.0f;
-	paddle.pos[2] = 0.0f;
-	paddle.color[0] = 0.85f;
-	paddle.color[1] = 0.85f;
-	paddle.color[2] = 0.85f;
-	paddle.left_down = 0;
-	paddle.right_down = 0;
-	paddle.width = 60.0f;
-	paddle.height = 8.0f;
-	paddle.dx = 3.0f;
-
-	GLfloat paddle_vertices[] = {
-		-paddle.width, -paddle.height,
-		-paddle.width,  paddle.height,
-		 paddle.width,  paddle.height,
-		 paddle.width,  paddle.height,
-		 paddle.width, -paddle.height,
-		-paddle.width, -paddle.height
-	};
-
-	glGenBuffers(1, &paddle.vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, paddle.vbo);
-	glBufferData(
-	    GL_ARRAY_BUFFER,
-	    sizeof(paddle_vertices),
-	    paddle_vertices,
-	    GL_STATIC_DRAW
-	);
-
-	// Initialize Bricks
-
-	bricks.width = 61.0f;
-	bricks.height = 14.0f;
-	bricks.x_padding = 5.0f;
-	bricks.y_padding = 2.0f;
-	
-	bricks.color[0][0] = 1.0f;
-	bricks.color[0][1] = 0.0f;
-	bricks.color[0][2] = 0.0f;
-
-	bricks.color[1][0] = 1.0f;
-	bricks.color[1][1] = 0.5f;
-	bricks.color[1][2] = 0.0f;
-
-	bricks.color[2][0] = 1.0f;
-	bricks.color[2][1] = 1.0f;
-	bricks.color[2][2] = 0.0f;
-
-	bricks.color[3][0] = 0.0f;
-	bricks.color[3][1] = 1.0f;
-	bricks.color[3][2] = 0.0f;
-
-	bricks.color[4][0] = 0.0f;
-	bricks.color[4][1] = 0.0f;
-	bricks.color[4][2] = 1.0f;
-
-	bricks.color[5][0] = 0.8f;
-	bricks.color[5][1] = 0.0f;
-	bricks.color[5][2] = 1.0f;
-
-	GLfloat brick_vertices[] = {
-		-bricks.width, -bricks.height,
-		-bricks.width,  bricks.height,
-		 bricks.width,  bricks.height,
-
-		 bricks.width,  bricks.height,
-		 bricks.width, -bricks.height,
-		-bricks.width, -bricks.height
-	};
-
-	glGenBuffers(1, &bricks.vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, bricks.vbo);
-	glBufferData(
-	    GL_ARRAY_BUFFER,
-	    sizeof(brick_vertices),
-	    brick_vertices,
-	    GL_STATIC_DRAW
-	);
-
-	for(i = 0; i < 30; i++) {
-		
-		row = i / 5;
-		col = i % 5;
-		
-		bricks.pos[i][0] = bricks.x_padding + bricks.width;
-		bricks.pos[i][0] += (bricks.x_padding * col) + (bricks.width * 2 * col);
-
-		bricks.pos[i][1] = bricks.y_padding + bricks.height;
-		bricks.pos[i][1] += (bricks.y_padding * row) + (bricks.height * 2 * row);
-		bricks.pos[i][1] = HEIGHT - bricks.pos[i][1];
-
-		bricks.pos[i][2] = 0.0f;
-		
-		bricks.active[i] = 1;
-
-	}
-
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(0);
-	glDisableVertexAttribArray(0);
-
-	program = dash_create_program("sdr/vertex.glsl", "sdr/fragment.glsl");
-	if(program == 0) {
-		fprintf(stderr, "Program creation error\n");
-		exit(1);
+	dash_program_cancel(program_job);
+	program_job = NULL;
+	if(program != 0) {
+		dash_delete_program(program);
+		program = 0;
 	}
 
-	const char *attribute_name = "coord2d";
-	attribute_coord2d = glGetAttribLocation(program, attribute_name);
-	if(attribute_coord2d == -1) {
-	    fprintf(stderr, "Could not bind attribute %s\n", attribute_name);
-	    return;
+	game_gfx_free(&gfx);
+	particles_gfx_free(&particles_gfx);
+	dash_hud_shutdown();
+	game_free(&game);
+	level_free(game.level);
+	game.level = NULL;
+	if(world) {
+		world_print(world, stdout);
+		world_close(world);
+		world = NULL;
 	}
-	
-	GLint uniform_ortho;
-	mat4 ortho;
-	mat4_orthographic(0, WIDTH, HEIGHT, 0, ortho);
-
-	const char *uniform_name;
-	uniform_name = "ortho";
-	uniform_ortho = glGetUniformLocation(program, uniform_name);
-	if(uniform_ortho == -1) {
-		fprintf(stderr, "Could not bind uniform %s\n", uniform_name);
-		return;
+	if(particles) {
+		particles_print(particles, stdout);
+		particles_free(particles);
+		particles = NULL;
+		game.particles = NULL;
 	}
 
-	uniform_name = "mvp";
-	uniform_mvp = glGetUniformLocation(program, uniform_name);
-	if(uniform_mvp == -1) {
-		fprintf(stderr, "Could not bind uniform %s\n", uniform_name);
-		return;
+	dash_resource_print(stdout);
+	leaks = dash_resource_leaks(stderr);
+	if(leaks > 0) {
+		fprintf(stderr, "%d resource(s) still allocated at shutdown\n", leaks);
 	}
 
-	uniform_name = "diffuse";
-	uniform_diffuse = glGetUniformLocation(program, uniform_name);
-	if(uniform_diffuse == -1) {
-		fprintf(stderr, "Could not bind uniform %s\n", uniform_name);
+}
+
+static void on_render(GtkGLArea *area, GdkGLContext *conext) {
+
+	vec3 paddle_pos;
+	gint64 now;
+	float frame_ms;
+
+	DASH_ZONE("on_render");
+
+	now = g_get_monotonic_time();
+	frame_ms = stats.last_frame ? (now - stats.last_frame) / 1000.0f : 0.0f;
+	stats.last_frame = now;
+
+	poll_program();
+
+	if(program == 0) {
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+#ifdef DASH_GL_STATS
+		dash_gl_stats_frame();
+#endif
 		return;
 	}
 
-	glUseProgram(program);
-	glUniformMatrix4fv(uniform_ortho, 1, GL_FALSE, ortho);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	printf("On Realize end\n");
-	
-	init = 1;
+	dash_gpu_timer_begin();
+	latency_render();
+
+	latch_paddle(now, paddle_pos);
+	if(world) {
+		world_update(world, 4);
+	}
+	// Particles go first, the overlay draws with the vertex array the
+	// game leaves bound
+	stats.draw_calls = 0;
+	if(particles) {
+		stats.draw_calls += particles_render(&particles_gfx, particles);
+	}
+	stats.draw_calls += game_render(&gfx, &game, paddle_pos);
+
+	dash_gpu_timer_end();
+
+	// The overlay is drawn after the timer so it does not count itself
+
+	dash_hud_frame(frame_ms, stats.ticks, stats.draw_calls, dash_gpu_timer_ms());
+	stats.ticks = 0;
+	dash_hud_draw(WIDTH, HEIGHT);
+
+#ifdef DASH_GL_STATS
+	dash_gl_stats_frame();
+#endif
 
 }
 
-static void on_render(GtkGLArea *area, GdkGLContext *conext) {
+static int bind_program() {
 
-	int i, row, col;
-	mat4 mvp;
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	return game_gfx_bind(&gfx, &game, program);
 
-  	glBindVertexArray (vao);
-  	glEnableVertexAttribArray(attribute_coord2d);
-	
-	glBindBuffer(GL_ARRAY_BUFFER, ball.vbo);
-	glVertexAttribPointer(
-	    attribute_coord2d,
-	    2,
-	    GL_FLOAT,
-	    GL_FALSE,
-	    0,
-	    0
-	);
-
-	mat4_translate(ball.pos, mvp);
-	glUniformMatrix4fv(uniform_mvp, 1, GL_FALSE, mvp);
-	glUniform3fv(uniform_diffuse, 1, ball.color);
-	glDrawArrays(GL_TRIANGLES, 0, ball.segments * 3);
-
-	glBindBuffer(GL_ARRAY_BUFFER, paddle.vbo);
-	glVertexAttribPointer(
-	    attribute_coord2d,
-	    2,
-	    GL_FLOAT,
-	    GL_FALSE,
-	    0,
-	    0
-	);
-
-	mat4_translate(paddle.pos, mvp);
-	glUniformMatrix4fv(uniform_mvp, 1, GL_FALSE, mvp);
-	glUniform3fv(uniform_diffuse, 1, paddle.color);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, bricks.vbo);
-	glVertexAttribPointer(
-	    attribute_coord2d,
-	    2,
-	    GL_FLOAT,
-	    GL_FALSE,
-	    0,
-	    0
-	);
-
-	for(i = 0; i < 30; i++) {
-		
-		row = i / 5;
-		col = i % 5;
-
-		if(col == 0) {
-			glUniform3fv(uniform_diffuse, 1, bricks.color[row]);
-		}
-		
-		if(bricks.active[i] == 0) {
-			continue;
+static void poll_program() {
+
+	char *vs_source, *fs_source;
+	GLuint old_program, new_program;
+	int status;
+
+	DASH_ZONE("poll_program");
+
+	// Sources from the watcher start a new job, replacing any reload
+	// that is still compiling
+
+	if(program != 0 && dash_watch_changed(&vs_source, &fs_source)) {
+		dash_program_cancel(program_job);
+		program_job = dash_create_program_source_async(vs_source, fs_source);
+		free(vs_source);
+		free(fs_source);
+	}
+
+	if(program_job == NULL) {
+		return;
+	}
+
+	status = dash_program_poll(program_job, &new_program);
+	if(status == 0) {
+		return;
+	}
+	program_job = NULL;
+
+	if(status < 0) {
+		if(program == 0) {
+			fprintf(stderr, "Program creation error\n");
+			exit(1);
 		}
+		fprintf(stderr, "Shader reload failed, keeping previous program\n");
+		return;
+	}
 
-		mat4_translate(bricks.pos[i], mvp);
-		glUniformMatrix4fv(uniform_mvp, 1, GL_FALSE, mvp);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		
+	old_program = program;
+	program = new_program;
+
+	if(bind_program() != 0) {
+		if(old_program == 0) {
+			fprintf(stderr, "Program creation error\n");
+			exit(1);
+		}
+		fprintf(stderr, "Shader reload failed, keeping previous program\n");
+		program = old_program;
+		dash_delete_program(new_program);
+		bind_program();
+		return;
 	}
 
+	if(old_program != 0) {
+		dash_delete_program(old_program);
+		printf("Shaders reloaded\n");
+	}
 
-	glDisableVertexAttribArray(attribute_coord2d);
+	init = 1;
 
 }
 
 static gboolean on_idle(gpointer data) {
 
+	// Keep frames coming while the program compiles so that
+	// on_render can poll it
 	if( init == 0 ) {
-		return FALSE;
+		gtk_widget_queue_draw(glArea);
+		return TRUE;
 	}
 	
-	int i;
-	float bl, br, bt, bb;
+	DASH_ZONE("on_idle");
 
-	// Advance Ball
+	stats.ticks++;
+	late_latch.last_tick = g_get_monotonic_time();
 
-	ball.pos[0] += ball.dx;
-	ball.pos[1] += ball.dy; 
+	game_tick(&game);
+	latency_tick();
 
-	if(ball.pos[0] + ball.radius > WIDTH) {
-		ball.pos[0] = WIDTH - ball.radius;
-		ball.dx = -ball.dx;
-	} else if(ball.pos[0] - ball.radius < 0.0f){
-		ball.pos[0] = ball.radius;
-		ball.dx = -ball.dx;
-	}
+	gtk_widget_queue_draw(glArea);
 
-	if(ball.pos[1] + ball.radius > HEIGHT) {
-		ball.pos[1] = HEIGHT - ball.radius;
-		ball.dy = -ball.dy;
-	} else if(ball.pos[1] - ball.radius < 0.0f){
-		ball.pos[1] = ball.radius;
-		ball.dy = -ball.dy;
-	}
+	return TRUE;
 
-	// Advance Paddle
+}
 
-	if(paddle.left_down) {
-		paddle.pos[0] -= paddle.dx;
-	}
-	if(paddle.right_down) {
-		paddle.pos[0] += paddle.dx;
-	}
+static void latch_start() {
 
-	if(paddle.pos[0] < 0.0f) {
-		paddle.pos[0] = 0.0f;
-	} else if(paddle.pos[0] > WIDTH) {
-		paddle.pos[0] = WIDTH;
+	if(late_latch.frame_callback == 0) {
+		late_latch.frame_callback = gtk_widget_add_tick_callback(glArea, on_frame_tick, NULL, NULL);
 	}
 
-	// Ball Collision with Paddle
-	
-	if(ball.dy < 0) {
-		
-		if(
-			ball.pos[0] >= paddle.pos[0]-paddle.width && 
-			ball.pos[0] <= paddle.pos[0]+paddle.width &&
-			ball.pos[1] - ball.radius >= paddle.pos[1]-paddle.height &&
-			ball.pos[1] - ball.radius <= paddle.pos[1]
-		  ) {
-			
-			ball.dy = -1.05 * ball.dy;
-
-			if(paddle.left_down) {
-				ball.dx -= paddle.dx / 4;
-			} else if(paddle.right_down) {
-				ball.dx += paddle.dx / 4;
-			}
-		}
+}
+
+static gboolean on_frame_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data) {
 
+	// Input that came in since the last frame is drawn in this one,
+	// without waiting for on_idle to queue it
+	if(!late_latch.enabled) {
+		late_latch.frame_callback = 0;
+		return G_SOURCE_REMOVE;
 	}
 
-	// Ball Collision With Bricks
-	
-	bl = ball.pos[0] - ball.radius;
-	br = ball.pos[0] + ball.radius;
-	bt = ball.pos[1] + ball.radius;
-	bb = ball.pos[1] - ball.radius;
-
-	for(i = 0; i < 30; i++) {
-		
-			if(bricks.active[i] == 0) {
-				continue;
-			}
+	gtk_widget_queue_draw(widget);
+	return G_SOURCE_CONTINUE;
 
-			if(
-				bl > bricks.pos[i][0] - bricks.width &&
-				br < bricks.pos[i][0] + bricks.width
-			) {
-				if( 
-				ball.pos[1] < bricks.pos[i][1] + bricks.height &&
-				ball.pos[1] > bricks.pos[i][1] - bricks.height
-			   ) {
-				ball.dy = -ball.dy;
-				bricks.active[i] = 0;
-			}
-		}
+}
+
+static void latch_paddle(gint64 now, vec3 pos) {
 
+	float elapsed, x;
+
+	pos[0] = game.paddle.pos[0];
+	pos[1] = game.paddle.pos[1];
+	pos[2] = game.paddle.pos[2];
+
+	if(!late_latch.enabled || late_latch.last_tick == 0) {
+		return;
 	}
 
-	gtk_widget_queue_draw(glArea);
+	// Fraction of the next tick that has already passed, never more than
+	// one tick so a stalled timer does not fling the paddle away
+	elapsed = (now - late_latch.last_tick) / (TICK_MS * 1000.0f);
+	if(elapsed > 1.0f) {
+		elapsed = 1.0f;
+	}
 
-	return TRUE;
+	x = game.paddle.pos[0];
+	if(game.paddle.left_down) {
+		x -= game.paddle.dx * elapsed;
+	}
+	if(game.paddle.right_down) {
+		x += game.paddle.dx * elapsed;
+	}
+
+	if(x < 0.0f) {
+		x = 0.0f;
+	} else if(x > WIDTH) {
+		x = WIDTH;
+	}
+	pos[0] = x;
 
 }
 
 static gint on_destroy(GtkWidget *widget) {
 
+	const char *trace;
+
 	printf("Widget destroyed\n");
+
+	session_record_end(record, game.ticks);
+	record = NULL;
+
+	latency_print();
+
+	trace = getenv("DASH_TRACE");
+	if(trace != NULL && dash_profile_dump(trace) == 0) {
+		printf("Trace written to %s\n", trace);
+	}
+
+#ifdef DASH_GL_STATS
+	unsigned long hits, misses;
+	dash_gl_stats_print(stdout);
+	dash_state_counters(&hits, &misses);
+	printf("GL state cache: %lu calls dropped, %lu forwarded\n", hits, misses);
+#endif
 	
 }
 
 static gboolean on_keydown(GtkWidget *widget, GdkEventKey *event) {
 
+	// Key repeat sends presses that change nothing, only the first
+	// press of a key is timed
 	switch(event->keyval) {
 		case GDK_KEY_Left:
-			paddle.left_down = TRUE;
+			if(!game.paddle.left_down) {
+				latency_input();
+				session_record_key(record, game.ticks, SESSION_LEFT, 1);
+			}
+			game.paddle.left_down = TRUE;
 		break;
 		case GDK_KEY_Right:
-			paddle.right_down = TRUE;
+			if(!game.paddle.right_down) {
+				latency_input();
+				session_record_key(record, game.ticks, SESSION_RIGHT, 1);
+			}
+			game.paddle.right_down = TRUE;
+		break;
+		case GDK_KEY_F3:
+			dash_hud_toggle();
+		break;
+		case GDK_KEY_F4:
+			late_latch.enabled = !late_latch.enabled;
+			if(late_latch.enabled) {
+				latch_start();
+			}
+			printf("Late latched paddle %s\n", late_latch.enabled ? "on" : "off");
 		break;
 	}
 
@@ -534,11 +602,190 @@ static gboolean on_keyup(GtkWidget *widget, GdkEventKey *event) {
 
 	switch(event->keyval) {
 		case GDK_KEY_Left:
-			paddle.left_down = FALSE;
+			latency_input();
+			session_record_key(record, game.ticks, SESSION_LEFT, 0);
+			game.paddle.left_down = FALSE;
 		break;
 		case GDK_KEY_Right:
-			paddle.right_down = FALSE;
+			latency_input();
+			session_record_key(record, game.ticks, SESSION_RIGHT, 0);
+			game.paddle.right_down = FALSE;
 		break;
 	}
 
 }
+
+static void latency_record(struct latency_histogram *h, gint64 us) {
+
+	int bucket;
+
+	if(us < 0) {
+		us = 0;
+	}
+
+	bucket = us / 500;
+	if(bucket >= LATENCY_BUCKETS) {
+		bucket = LATENCY_BUCKETS - 1;
+	}
+
+	h->buckets[bucket]++;
+	h->count++;
+	if(us > h->max) {
+		h->max = us;
+	}
+
+}
+
+static void latency_input() {
+
+	struct latency_sample *sample;
+
+	if(latency.num_pending == LATENCY_INFLIGHT) {
+		memmove(latency.pending, latency.pending + 1,
+			(LATENCY_INFLIGHT - 1) * sizeof(struct latency_sample));
+		latency.num_pending--;
+		latency.dropped++;
+	}
+
+	sample = &latency.pending[latency.num_pending++];
+	sample->stage = LATENCY_INPUT;
+	sample->input = g_get_monotonic_time();
+
+}
+
+static void latency_tick() {
+
+	gint64 now;
+	int i;
+
+	// Late latched, the next frame consumes the input instead
+	if(late_latch.enabled) {
+		return;
+	}
+
+	now = g_get_monotonic_time();
+	for(i = 0; i < latency.num_pending; i++) {
+		if(latency.pending[i].stage == LATENCY_INPUT) {
+			latency.pending[i].stage = LATENCY_TICKED;
+			latency.pending[i].tick = now;
+		}
+	}
+
+}
+
+static void latency_render() {
+
+	GdkFrameClock *clock;
+	GdkFrameTimings *timings;
+	struct latency_sample *sample;
+	gint64 now, frame, present;
+	int i, j;
+
+	if(latency.num_pending == 0) {
+		return;
+	}
+
+	clock = gtk_widget_get_frame_clock(glArea);
+	if(clock == NULL) {
+		return;
+	}
+
+	now = g_get_monotonic_time();
+	frame = gdk_frame_clock_get_frame_counter(clock);
+
+	for(i = 0, j = 0; i < latency.num_pending; i++) {
+
+		sample = &latency.pending[i];
+
+		// A late latched render consumes input without waiting for a tick
+		if(sample->stage == LATENCY_INPUT && late_latch.enabled) {
+			sample->stage = LATENCY_TICKED;
+			sample->tick = now;
+		}
+
+		if(sample->stage == LATENCY_TICKED) {
+			sample->stage = LATENCY_RENDERED;
+			sample->render = now;
+			sample->frame = frame;
+		}
+
+		// Presentation time is only known once the frame is complete,
+		// timings that fell out of the clock's history are dropped
+		if(sample->stage == LATENCY_RENDERED && sample->frame != frame) {
+
+			timings = gdk_frame_clock_get_timings(clock, sample->frame);
+			if(timings == NULL) {
+				latency.dropped++;
+				continue;
+			}
+
+			if(gdk_frame_timings_get_complete(timings)) {
+				present = gdk_frame_timings_get_presentation_time(timings);
+				if(present == 0) {
+					present = gdk_frame_timings_get_predicted_presentation_time(timings);
+				}
+				if(present == 0) {
+					latency.dropped++;
+					continue;
+				}
+				latency_record(&latency.input_to_tick, sample->tick - sample->input);
+				latency_record(&latency.tick_to_render, sample->render - sample->tick);
+				latency_record(&latency.render_to_present, present - sample->render);
+				latency_record(&latency.total, present - sample->input);
+				continue;
+			}
+
+		}
+
+		latency.pending[j++] = *sample;
+
+	}
+
+	latency.num_pending = j;
+
+}
+
+static float latency_percentile(struct latency_histogram *h, float p) {
+
+	unsigned int target, seen;
+	int i;
+
+	target = (unsigned int)ceilf(h->count * p);
+	if(target == 0) {
+		target = 1;
+	}
+
+	seen = 0;
+	for(i = 0; i < LATENCY_BUCKETS - 1; i++) {
+		seen += h->buckets[i];
+		if(seen >= target) {
+			return (i + 1) * 0.5f;
+		}
+	}
+	return h->max / 1000.0f;
+
+}
+
+static void latency_print_row(const char *name, struct latency_histogram *h) {
+
+	printf("  %-18s %7.1f %7.1f %7.1f %7.1f\n", name,
+		latency_percentile(h, 0.50f), latency_percentile(h, 0.90f),
+		latency_percentile(h, 0.99f), h->max / 1000.0f);
+
+}
+
+static void latency_print() {
+
+	if(latency.total.count == 0) {
+		return;
+	}
+
+	printf("Input latency over %u key events, %u dropped (ms)\n",
+		latency.total.count, latency.dropped);
+	printf("  %-18s %7s %7s %7s %7s\n", "", "p50", "p90", "p99", "max");
+	latency_print_row("input to tick", &latency.input_to_tick);
+	latency_print_row("tick to render", &latency.tick_to_render);
+	latency_print_row("render to present", &latency.render_to_present);
+	latency_print_row("input to present", &latency.total);
+
+}
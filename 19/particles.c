@@ -0,0 +1,544 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#include "lib/dashgl.h"
+#include "particles.h"
+
+// One register's worth of lanes, GCC splits it where the target has
+// narrower vectors
+typedef float particles_vec __attribute__((vector_size(PARTICLES_LANES * sizeof(float))));
+
+static double particles_now_ns() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}
+
+/******************************************************************************/
+/** Simulation                                                               **/
+/******************************************************************************/
+
+static void *particles_array(int capacity, int size) {
+
+	void *array;
+
+	array = aligned_alloc(sizeof(particles_vec), (long)capacity * size);
+	memset(array, 0, (long)capacity * size);
+	return array;
+
+}
+
+struct particles *particles_create(int capacity, unsigned int seed) {
+
+	struct particles *particles;
+
+	if(capacity < 1) {
+		fprintf(stderr, "Could not create a pool of %d particles\n", capacity);
+		return NULL;
+	}
+
+	// Whole blocks of lanes, so the update never needs a scalar tail
+	capacity = (capacity + PARTICLES_LANES - 1) / PARTICLES_LANES * PARTICLES_LANES;
+
+	particles = (struct particles*)calloc(1, sizeof(struct particles));
+	particles->capacity = capacity;
+	particles->x = (float*)particles_array(capacity, sizeof(float));
+	particles->y = (float*)particles_array(capacity, sizeof(float));
+	particles->dx = (float*)particles_array(capacity, sizeof(float));
+	particles->dy = (float*)particles_array(capacity, sizeof(float));
+	particles->age = (float*)particles_array(capacity, sizeof(float));
+	particles->color = (unsigned int*)particles_array(capacity, sizeof(unsigned int));
+
+	// Times are in ticks and pixels per tick
+	particles->life = 50.0f;
+	particles->gravity = 0.1f;
+	particles->speed = 3.0f;
+	particles->size = 3.0f;
+	particles->seed = seed;
+
+	dash_resource_track(DASH_RESOURCE_MEMORY, (unsigned long)particles,
+		sizeof(struct particles) + (long)capacity * 6 * sizeof(float), "particles");
+
+	return particles;
+
+}
+
+void particles_free(struct particles *particles) {
+
+	if(particles == NULL) {
+		return;
+	}
+
+	dash_resource_untrack(DASH_RESOURCE_MEMORY, (unsigned long)particles);
+	free(particles->x);
+	free(particles->y);
+	free(particles->dx);
+	free(particles->dy);
+	free(particles->age);
+	free(particles->color);
+	free(particles);
+
+}
+
+int particles_emit(struct particles *particles, float x, float y, vec3 color, int n) {
+
+	unsigned char rgba[4];
+	unsigned int packed;
+	float angle, speed;
+	int i, j;
+
+	if(n > particles->capacity - particles->count) {
+		particles->dropped += n - (particles->capacity - particles->count);
+		n = particles->capacity - particles->count;
+	}
+
+	rgba[0] = (unsigned char)(fminf(fmaxf(color[0], 0.0f), 1.0f) * 255.0f + 0.5f);
+	rgba[1] = (unsigned char)(fminf(fmaxf(color[1], 0.0f), 1.0f) * 255.0f + 0.5f);
+	rgba[2] = (unsigned char)(fminf(fmaxf(color[2], 0.0f), 1.0f) * 255.0f + 0.5f);
+	rgba[3] = 255;
+	memcpy(&packed, rgba, sizeof(packed));
+
+	// Burst out in every direction, a little upwards on average
+	for(i = 0; i < n; i++) {
+		j = particles->count++;
+		angle = (rand_r(&particles->seed) % 3600) * (float)M_PI / 1800.0f;
+		speed = (rand_r(&particles->seed) % 1000) * particles->speed / 1000.0f;
+		particles->x[j] = x;
+		particles->y[j] = y;
+		particles->dx[j] = cosf(angle) * speed;
+		particles->dy[j] = sinf(angle) * speed + particles->speed * 0.5f;
+		particles->age[j] = 0.0f;
+		particles->color[j] = packed;
+	}
+
+	particles->emitted += n;
+	if(particles->count > particles->peak) {
+		particles->peak = particles->count;
+	}
+
+	return n;
+
+}
+
+void particles_update(struct particles *particles) {
+
+	particles_vec *x, *y, *dx, *dy, *age;
+	double start;
+	float life, bottom;
+	int i, blocks, last;
+
+	DASH_ZONE("particles_update");
+	start = particles_now_ns();
+
+	// Lanes past count hold dead particles, moving them too is cheaper
+	// than a scalar tail
+	x = (particles_vec*)particles->x;
+	y = (particles_vec*)particles->y;
+	dx = (particles_vec*)particles->dx;
+	dy = (particles_vec*)particles->dy;
+	age = (particles_vec*)particles->age;
+	blocks = (particles->count + PARTICLES_LANES - 1) / PARTICLES_LANES;
+
+	for(i = 0; i < blocks; i++) {
+		dy[i] -= particles->gravity;
+		x[i] += dx[i];
+		y[i] += dy[i];
+		age[i] += 1.0f;
+	}
+
+	// Particles that are too old or fell off the bottom trade places
+	// with the last live one, which still has to be checked itself
+	life = particles->life;
+	bottom = -particles->size;
+	i = 0;
+	while(i < particles->count) {
+
+		if(particles->age[i] < life && particles->y[i] > bottom) {
+			i++;
+			continue;
+		}
+
+		last = --particles->count;
+		particles->x[i] = particles->x[last];
+		particles->y[i] = particles->y[last];
+		particles->dx[i] = particles->dx[last];
+		particles->dy[i] = particles->dy[last];
+		particles->age[i] = particles->age[last];
+		particles->color[i] = particles->color[last];
+
+	}
+
+	particles->timings.update_ns += particles_now_ns() - start;
+	particles->timings.updates++;
+
+}
+
+void particles_print(struct particles *particles, FILE *fp) {
+
+	fprintf(fp, "Particles: %d live, peak %d of %d, %lu emitted, %lu dropped\n",
+		particles->count, particles->peak, particles->capacity,
+		particles->emitted, particles->dropped);
+
+	if(particles->timings.updates > 0) {
+		fprintf(fp, "  update %.1f us per tick\n",
+			particles->timings.update_ns / particles->timings.updates / 1e3);
+	}
+
+	if(particles->timings.frames > 0) {
+		fprintf(fp, "  upload %.1f us, draw %.1f us per frame\n",
+			particles->timings.upload_ns / particles->timings.frames / 1e3,
+			particles->timings.draw_ns / particles->timings.frames / 1e3);
+	}
+
+}
+
+/******************************************************************************/
+/** Rendering                                                                **/
+/******************************************************************************/
+
+static int particles_attrib(GLuint program, const char *name, GLint *location) {
+
+	*location = glGetAttribLocation(program, name);
+	if(*location == -1) {
+		fprintf(stderr, "Could not bind attribute %s\n", name);
+		return -1;
+	}
+
+	return 0;
+
+}
+
+static int particles_software_renderer() {
+
+	const char *renderer;
+
+	renderer = (const char*)glGetString(GL_RENDERER);
+	return renderer != NULL && (
+		strstr(renderer, "llvmpipe") != NULL ||
+		strstr(renderer, "softpipe") != NULL ||
+		strstr(renderer, "SwiftShader") != NULL
+	);
+
+}
+
+static int particles_splat_init(struct particles_gfx *gfx, float width, float height) {
+
+	static const GLfloat corners[] = {
+		0.0f, 0.0f,
+		0.0f, 1.0f,
+		1.0f, 1.0f,
+		1.0f, 1.0f,
+		1.0f, 0.0f,
+		0.0f, 0.0f
+	};
+
+	GLint uniform_splat;
+
+	gfx->program = dash_create_program("sdr/particle_splat_vertex.glsl", "sdr/particle_splat_fragment.glsl");
+	if(gfx->program == 0) {
+		return -1;
+	}
+
+	uniform_splat = glGetUniformLocation(gfx->program, "splat");
+	if(particles_attrib(gfx->program, "corner", &gfx->attribute_corner) != 0 || uniform_splat == -1) {
+		fprintf(stderr, "Could not bind particle splat shader\n");
+		particles_gfx_free(gfx);
+		return -1;
+	}
+
+	dash_use_program(gfx->program);
+	dash_uniform1i(uniform_splat, 0);
+
+	// One texel per unit of the game's coordinates, so a particle
+	// covers the same pixels it would as a point
+	gfx->width = (int)width;
+	gfx->height = (int)height;
+	gfx->pixels = (unsigned int*)calloc((long)gfx->width * gfx->height, sizeof(unsigned int));
+
+	glGenTextures(1, &gfx->texture);
+	glBindTexture(GL_TEXTURE_2D, gfx->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, gfx->width, gfx->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, gfx->pixels);
+	dash_resource_track(DASH_RESOURCE_TEXTURE, gfx->texture,
+		(long)gfx->width * gfx->height * 4, "particle splat");
+
+	glGenVertexArrays(1, &gfx->vao);
+	dash_bind_vertex_array(gfx->vao);
+	gfx->corner_vbo = dash_create_buffer(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW, "particle splat quad");
+	dash_enable_attrib(gfx->attribute_corner);
+	dash_attrib_pointer(gfx->attribute_corner, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	return 0;
+
+}
+
+int particles_gfx_init(struct particles_gfx *gfx, struct particles *particles, float width, float height, int mode) {
+
+	static const GLfloat corners[] = {
+		-1.0f, -1.0f,
+		-1.0f,  1.0f,
+		 1.0f,  1.0f,
+		 1.0f,  1.0f,
+		 1.0f, -1.0f,
+		-1.0f, -1.0f
+	};
+
+	GLint uniform_ortho;
+	mat4 ortho;
+
+	memset(gfx, 0, sizeof(struct particles_gfx));
+
+	if(mode == PARTICLES_AUTO) {
+		mode = particles_software_renderer() ? PARTICLES_SPLAT : PARTICLES_INSTANCED;
+	}
+	if(mode == PARTICLES_INSTANCED && !GLEW_VERSION_3_3 && !GLEW_ARB_instanced_arrays) {
+		mode = PARTICLES_POINTS;
+	}
+	gfx->mode = mode;
+
+	if(gfx->mode == PARTICLES_SPLAT) {
+		return particles_splat_init(gfx, width, height);
+	}
+
+	gfx->program = dash_create_program("sdr/particle_vertex.glsl", "sdr/particle_fragment.glsl");
+	if(gfx->program == 0) {
+		return -1;
+	}
+
+	if(
+		particles_attrib(gfx->program, "corner", &gfx->attribute_corner) != 0 ||
+		particles_attrib(gfx->program, "pos_x", &gfx->attribute_pos_x) != 0 ||
+		particles_attrib(gfx->program, "pos_y", &gfx->attribute_pos_y) != 0 ||
+		particles_attrib(gfx->program, "age", &gfx->attribute_age) != 0 ||
+		particles_attrib(gfx->program, "color", &gfx->attribute_color) != 0
+	) {
+		particles_gfx_free(gfx);
+		return -1;
+	}
+
+	uniform_ortho = glGetUniformLocation(gfx->program, "ortho");
+	gfx->uniform_size = glGetUniformLocation(gfx->program, "size");
+	gfx->uniform_life = glGetUniformLocation(gfx->program, "life");
+	if(uniform_ortho == -1 || gfx->uniform_size == -1 || gfx->uniform_life == -1) {
+		fprintf(stderr, "Could not bind particle uniforms\n");
+		particles_gfx_free(gfx);
+		return -1;
+	}
+
+	dash_use_program(gfx->program);
+	mat4_orthographic(0, width, height, 0, ortho);
+	dash_uniform_matrix4fv(uniform_ortho, ortho);
+
+	// The vertex array of its own keeps the divisors away from the
+	// attributes of other programs
+
+	glGenVertexArrays(1, &gfx->vao);
+	dash_bind_vertex_array(gfx->vao);
+
+	if(gfx->mode == PARTICLES_INSTANCED) {
+		gfx->corner_vbo = dash_create_buffer(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW, "particle quad");
+		dash_enable_attrib(gfx->attribute_corner);
+		dash_attrib_pointer(gfx->attribute_corner, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+
+	// The pointers into the sections are set by particles_render, as
+	// the sections move with the number of live particles
+
+	gfx->instance_vbo = dash_create_buffer(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW, "particles");
+	dash_enable_attrib(gfx->attribute_pos_x);
+	dash_enable_attrib(gfx->attribute_pos_y);
+	dash_enable_attrib(gfx->attribute_age);
+	dash_enable_attrib(gfx->attribute_color);
+	if(gfx->mode == PARTICLES_INSTANCED) {
+		glVertexAttribDivisor(gfx->attribute_pos_x, 1);
+		glVertexAttribDivisor(gfx->attribute_pos_y, 1);
+		glVertexAttribDivisor(gfx->attribute_age, 1);
+		glVertexAttribDivisor(gfx->attribute_color, 1);
+	}
+
+	return 0;
+
+}
+
+const char *particles_mode_name(int mode) {
+
+	switch(mode) {
+		case PARTICLES_INSTANCED:
+			return "instanced";
+		case PARTICLES_POINTS:
+			return "points";
+		case PARTICLES_SPLAT:
+			return "splat";
+	}
+
+	return "auto";
+
+}
+
+static int particles_splat(struct particles_gfx *gfx, struct particles *particles) {
+
+	unsigned int *row, color;
+	float half, scale;
+	int i, x, y, x0, x1, y0, y1;
+	double start;
+
+	// The squares a point of size 2 * size * fade would cover, the
+	// texel centres inside it, at least the one under the particle.
+	// Later particles are written over earlier ones, as they are drawn.
+	start = particles_now_ns();
+	memset(gfx->pixels, 0, (long)gfx->width * gfx->height * sizeof(unsigned int));
+	scale = particles->size / particles->life;
+	for(i = 0; i < particles->count; i++) {
+
+		half = particles->size - particles->age[i] * scale;
+		x0 = (int)ceilf(particles->x[i] - half - 0.5f);
+		x1 = (int)ceilf(particles->x[i] + half - 0.5f);
+		y0 = (int)ceilf(particles->y[i] - half - 0.5f);
+		y1 = (int)ceilf(particles->y[i] + half - 0.5f);
+		if(x1 <= x0) {
+			x0 = (int)floorf(particles->x[i]);
+			x1 = x0 + 1;
+		}
+		if(y1 <= y0) {
+			y0 = (int)floorf(particles->y[i]);
+			y1 = y0 + 1;
+		}
+
+		if(x0 < 0) {
+			x0 = 0;
+		}
+		if(x1 > gfx->width) {
+			x1 = gfx->width;
+		}
+		if(y0 < 0) {
+			y0 = 0;
+		}
+		if(y1 > gfx->height) {
+			y1 = gfx->height;
+		}
+
+		color = particles->color[i];
+		for(y = y0; y < y1; y++) {
+			row = gfx->pixels + (long)y * gfx->width;
+			for(x = x0; x < x1; x++) {
+				row[x] = color;
+			}
+		}
+
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, gfx->texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, gfx->width, gfx->height, GL_RGBA, GL_UNSIGNED_BYTE, gfx->pixels);
+	particles->timings.upload_ns += particles_now_ns() - start;
+
+	start = particles_now_ns();
+	dash_use_program(gfx->program);
+	dash_bind_vertex_array(gfx->vao);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	particles->timings.draw_ns += particles_now_ns() - start;
+	particles->timings.frames++;
+
+	return 1;
+
+}
+
+int particles_render(struct particles_gfx *gfx, struct particles *particles) {
+
+	long section;
+	double start;
+
+	DASH_ZONE("particles_render");
+
+	if(gfx->program == 0 || particles->count == 0) {
+		return 0;
+	}
+
+	if(gfx->mode == PARTICLES_SPLAT) {
+		return particles_splat(gfx, particles);
+	}
+
+	// A new store every frame, so the driver does not wait for last
+	// frame's draw before the new positions go in
+	start = particles_now_ns();
+	section = (long)particles->count * sizeof(float);
+	dash_bind_vertex_array(gfx->vao);
+	dash_bind_buffer(GL_ARRAY_BUFFER, gfx->instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, section * 4, NULL, GL_STREAM_DRAW);
+	dash_resource_resize(DASH_RESOURCE_BUFFER, gfx->instance_vbo, section * 4);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, section, particles->x);
+	glBufferSubData(GL_ARRAY_BUFFER, section, section, particles->y);
+	glBufferSubData(GL_ARRAY_BUFFER, 2 * section, section, particles->age);
+	glBufferSubData(GL_ARRAY_BUFFER, 3 * section, section, particles->color);
+	dash_attrib_pointer(gfx->attribute_pos_x, 1, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	dash_attrib_pointer(gfx->attribute_pos_y, 1, GL_FLOAT, GL_FALSE, 0, (void*)section);
+	dash_attrib_pointer(gfx->attribute_age, 1, GL_FLOAT, GL_FALSE, 0, (void*)(2 * section));
+	dash_attrib_pointer(gfx->attribute_color, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void*)(3 * section));
+	particles->timings.upload_ns += particles_now_ns() - start;
+
+	start = particles_now_ns();
+	dash_use_program(gfx->program);
+	glUniform1f(gfx->uniform_size, particles->size);
+	glUniform1f(gfx->uniform_life, particles->life);
+	if(gfx->mode == PARTICLES_POINTS) {
+		// The corner is a constant, which is not kept by the vertex array
+		glVertexAttrib2f(gfx->attribute_corner, 0.0f, 0.0f);
+		glEnable(GL_PROGRAM_POINT_SIZE);
+		glDrawArrays(GL_POINTS, 0, particles->count);
+		glDisable(GL_PROGRAM_POINT_SIZE);
+	} else {
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, particles->count);
+	}
+	particles->timings.draw_ns += particles_now_ns() - start;
+	particles->timings.frames++;
+
+	return 1;
+
+}
+
+void particles_gfx_free(struct particles_gfx *gfx) {
+
+	if(gfx->corner_vbo) {
+		dash_delete_buffer(gfx->corner_vbo);
+	}
+	if(gfx->instance_vbo) {
+		dash_delete_buffer(gfx->instance_vbo);
+	}
+	if(gfx->texture) {
+		dash_delete_texture(gfx->texture);
+	}
+	free(gfx->pixels);
+	if(gfx->vao) {
+		glDeleteVertexArrays(1, &gfx->vao);
+	}
+	if(gfx->program) {
+		dash_delete_program(gfx->program);
+	}
+	memset(gfx, 0, sizeof(struct particles_gfx));
+	dash_state_reset();
+
+}
@@ -0,0 +1,113 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BRICKOUT_PARTICLES
+#define BRICKOUT_PARTICLES
+
+	/**********************************************************************/
+	/** Simulation                                                       **/
+	/**********************************************************************/
+
+	// A fixed pool of particles kept as one array per field, live ones
+	// packed at the front. particles_update moves and ages PARTICLES_LANES
+	// of them at a time and swaps the last live particle into the slot of
+	// each one that died. Emitting into a full pool drops the particles
+	// that do not fit rather than growing it.
+
+	#define PARTICLES_LANES 8
+
+	struct particles {
+		int count;
+		int capacity;
+		float *x;
+		float *y;
+		float *dx;
+		float *dy;
+		float *age;
+		unsigned int *color;
+		float life;
+		float gravity;
+		float speed;
+		float size;
+		unsigned int seed;
+		int peak;
+		unsigned long emitted;
+		unsigned long dropped;
+		struct {
+			double update_ns;
+			double upload_ns;
+			double draw_ns;
+			unsigned long updates;
+			unsigned long frames;
+		} timings;
+	};
+
+	struct particles *particles_create(int capacity, unsigned int seed);
+	void particles_free(struct particles *particles);
+	int particles_emit(struct particles *particles, float x, float y, vec3 color, int n);
+	void particles_update(struct particles *particles);
+	void particles_print(struct particles *particles, FILE *fp);
+
+	/**********************************************************************/
+	/** Rendering                                                        **/
+	/**********************************************************************/
+
+	// Position, age and color come straight from the pool arrays,
+	// uploaded each frame in sections of one buffer sized to the live
+	// particles, so all of them take a single draw. Each one is an
+	// instance of a small quad, or with PARTICLES_POINTS, or without
+	// instanced arrays, a point sprite of the same size.
+	//
+	// Software renderers like llvmpipe set up every point or instance
+	// on their own and need several times a frame's budget for 100000
+	// of them. PARTICLES_SPLAT writes the same squares into a texture
+	// on the CPU instead, which is uploaded and drawn as one quad
+	// covering the screen. PARTICLES_AUTO picks it on those renderers
+	// and instances everywhere else.
+
+	enum {
+		PARTICLES_AUTO,
+		PARTICLES_INSTANCED,
+		PARTICLES_POINTS,
+		PARTICLES_SPLAT
+	};
+
+	struct particles_gfx {
+		int mode;
+		GLuint program;
+		GLuint vao;
+		GLuint corner_vbo;
+		GLuint instance_vbo;
+		GLuint texture;
+		unsigned int *pixels;
+		int width;
+		int height;
+		GLint attribute_corner;
+		GLint attribute_pos_x;
+		GLint attribute_pos_y;
+		GLint attribute_age;
+		GLint attribute_color;
+		GLint uniform_size;
+		GLint uniform_life;
+	};
+
+	int particles_gfx_init(struct particles_gfx *gfx, struct particles *particles, float width, float height, int mode);
+	const char *particles_mode_name(int mode);
+	int particles_render(struct particles_gfx *gfx, struct particles *particles);
+	void particles_gfx_free(struct particles_gfx *gfx);
+
+#endif
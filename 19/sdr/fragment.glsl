@@ -1,9 +1,10 @@
 #version 130
 
 uniform vec3 diffuse;
+varying vec3 f_color;
 
 void main(void) {
 
-	gl_FragColor = vec4(diffuse, 1.0);
+	gl_FragColor = vec4(diffuse * f_color, 1.0);
 
 }
@@ -0,0 +1,11 @@
+#version 130
+
+uniform sampler2D glyphs;
+varying vec2 f_uv;
+varying vec4 f_color;
+
+void main(void) {
+
+	gl_FragColor = vec4(f_color.rgb, f_color.a * texture2D(glyphs, f_uv).a);
+
+}
@@ -0,0 +1,16 @@
+#version 130
+
+attribute vec2 coord2d;
+attribute vec2 uv;
+attribute vec4 color;
+uniform mat4 ortho;
+varying vec2 f_uv;
+varying vec4 f_color;
+
+void main (void) {
+	
+	f_uv = uv;
+	f_color = color;
+	gl_Position = ortho * vec4(coord2d, 0.0, 1.0);
+
+}
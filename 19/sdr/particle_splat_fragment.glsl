@@ -0,0 +1,14 @@
+#version 130
+
+uniform sampler2D splat;
+varying vec2 f_uv;
+
+void main(void) {
+
+	vec4 texel = texture2D(splat, f_uv);
+	if(texel.a == 0.0) {
+		discard;
+	}
+	gl_FragColor = vec4(texel.rgb, 1.0);
+
+}
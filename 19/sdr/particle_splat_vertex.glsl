@@ -0,0 +1,13 @@
+#version 130
+
+attribute vec2 corner;
+varying vec2 f_uv;
+
+void main (void) {
+
+	// One quad over the whole screen, the texture is laid out bottom
+	// row first like the game's coordinates
+	f_uv = corner;
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+
+}
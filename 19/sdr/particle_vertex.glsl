@@ -0,0 +1,21 @@
+#version 130
+
+attribute vec2 corner;
+attribute float pos_x;
+attribute float pos_y;
+attribute float age;
+attribute vec4 color;
+uniform mat4 ortho;
+uniform float size, life;
+varying vec3 f_color;
+
+void main (void) {
+
+	// Particles shrink away as they age, drawn as points the corner
+	// stays at 0 and the point covers the same square
+	float fade = 1.0 - age / life;
+	gl_Position = ortho * vec4(vec2(pos_x, pos_y) + corner * size * fade, 0.0, 1.0);
+	gl_PointSize = 2.0 * size * fade;
+	f_color = color.rgb;
+
+}
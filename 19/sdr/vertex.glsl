@@ -1,10 +1,13 @@
 #version 130
 
 attribute vec2 coord2d;
+attribute vec3 color;
 uniform mat4 ortho, mvp;
+varying vec3 f_color;
 
 void main (void) {
 	
 	gl_Position = ortho * mvp *vec4(coord2d, 0.0, 1.0);
+	f_color = color;
 
 }
@@ -0,0 +1,134 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "session.h"
+
+static const char *session_keys[] = { "left", "right" };
+
+struct session *session_load(const char *filename) {
+
+	FILE *fp;
+	struct session *session;
+	char line[256], key[16];
+	unsigned long tick;
+	int down, size;
+
+	fp = fopen(filename, "r");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return NULL;
+	}
+
+	session = (struct session*)calloc(1, sizeof(struct session));
+	strcpy(session->level, "classic");
+	session->balls = 1;
+	size = 0;
+
+	while(fgets(line, sizeof(line), fp)) {
+
+		if(line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+
+		if(sscanf(line, "key %lu %15s %d", &tick, key, &down) == 3) {
+
+			if(session->num_events == size) {
+				size = size ? size * 2 : 64;
+				session->events = (struct session_event*)realloc(session->events,
+					size * sizeof(struct session_event));
+			}
+
+			session->events[session->num_events].tick = tick;
+			session->events[session->num_events].key = strcmp(key, "left") == 0 ? SESSION_LEFT : SESSION_RIGHT;
+			session->events[session->num_events].down = down;
+			session->num_events++;
+
+		} else if(
+			sscanf(line, "level %31s", session->level) != 1 &&
+			sscanf(line, "balls %d", &session->balls) != 1 &&
+			sscanf(line, "seed %u", &session->seed) != 1 &&
+			sscanf(line, "ticks %lu", &session->ticks) != 1
+		) {
+			fprintf(stderr, "Could not parse session line: %s", line);
+		}
+
+	}
+
+	fclose(fp);
+
+	if(session->ticks == 0) {
+		fprintf(stderr, "Session %s has no ticks\n", filename);
+		session_free(session);
+		return NULL;
+	}
+
+	return session;
+
+}
+
+void session_free(struct session *session) {
+
+	if(session == NULL) {
+		return;
+	}
+
+	free(session->events);
+	free(session);
+
+}
+
+FILE *session_record(const char *filename, const char *level, int balls, unsigned int seed) {
+
+	FILE *fp;
+
+	fp = fopen(filename, "w");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for writing\n", filename);
+		return NULL;
+	}
+
+	fprintf(fp, "# brickout session 1\n");
+	fprintf(fp, "level %s\n", level);
+	fprintf(fp, "balls %d\n", balls);
+	fprintf(fp, "seed %u\n", seed);
+	return fp;
+
+}
+
+void session_record_key(FILE *fp, unsigned long tick, int key, int down) {
+
+	if(fp == NULL) {
+		return;
+	}
+
+	fprintf(fp, "key %lu %s %d\n", tick, session_keys[key], down);
+
+}
+
+void session_record_end(FILE *fp, unsigned long ticks) {
+
+	if(fp == NULL) {
+		return;
+	}
+
+	fprintf(fp, "ticks %lu\n", ticks);
+	fclose(fp);
+
+}
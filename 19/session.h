@@ -0,0 +1,63 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BRICKOUT_SESSION
+#define BRICKOUT_SESSION
+
+	/**********************************************************************/
+	/** Recorded Sessions                                                **/
+	/**********************************************************************/
+
+	// A session is a text file holding everything needed to play a game
+	// again without a window: the level, ball count, random seed and
+	// every paddle key change together with the tick it applies before.
+	//
+	//     # brickout session 1
+	//     level 64x32
+	//     balls 16
+	//     seed 1234
+	//     key 120 right 1
+	//     key 161 right 0
+	//     ticks 3000
+
+	enum {
+		SESSION_LEFT,
+		SESSION_RIGHT
+	};
+
+	struct session_event {
+		unsigned long tick;
+		int key;
+		int down;
+	};
+
+	struct session {
+		char level[32];
+		int balls;
+		unsigned int seed;
+		unsigned long ticks;
+		int num_events;
+		struct session_event *events;
+	};
+
+	struct session *session_load(const char *filename);
+	void session_free(struct session *session);
+	FILE *session_record(const char *filename, const char *level, int balls, unsigned int seed);
+	void session_record_key(FILE *fp, unsigned long tick, int key, int down);
+	void session_record_end(FILE *fp, unsigned long ticks);
+
+#endif
@@ -0,0 +1,304 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Usage: atlas [-s page_size] [-p padding] -o <prefix> <file.png>...
+ *
+ * Packs the images into as few square RGBA pages as possible and writes
+ * <prefix>_<n>.png for each page plus <prefix>.atlas, the metadata read
+ * by dash_atlas_load. Images are placed tallest first on shelves. Each
+ * one is surrounded by padding filled with copies of its edge pixels,
+ * so linear filtering never picks up a neighbouring sprite.
+ *
+ * The metadata is plain text, sorted by sprite name:
+ *
+ *     dashgl-atlas 1
+ *     page <index> <file> <width> <height>
+ *     sprite <name> <page> <x> <y> <width> <height>
+ */
+
+#include <png.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+
+struct sprite {
+	char name[256];
+	unsigned char *pixels;
+	int width;
+	int height;
+	int page;
+	int x;
+	int y;
+};
+
+static int compare_height(const void *a, const void *b) {
+
+	const struct sprite *sa = (const struct sprite*)a;
+	const struct sprite *sb = (const struct sprite*)b;
+
+	if(sa->height != sb->height) {
+		return sb->height - sa->height;
+	}
+	return sb->width - sa->width;
+
+}
+
+static int compare_name(const void *a, const void *b) {
+
+	return strcmp(((const struct sprite*)a)->name, ((const struct sprite*)b)->name);
+
+}
+
+static void sprite_name(const char *filename, char *name, size_t size) {
+
+	const char *base, *dot;
+
+	base = strrchr(filename, '/');
+	base = base ? base + 1 : filename;
+	dot = strrchr(base, '.');
+	if(dot == NULL) {
+		dot = base + strlen(base);
+	}
+	snprintf(name, size, "%.*s", (int)(dot - base), base);
+
+}
+
+static unsigned char *load_rgba(const char *filename, int *width, int *height) {
+
+	unsigned char *data, *rgba;
+	GLenum format;
+	int i, count;
+
+	data = dash_png_read(filename, width, height, &format);
+	if(data == NULL || format == GL_RGBA) {
+		return data;
+	}
+
+	count = *width * *height;
+	rgba = (unsigned char*)malloc(count * 4);
+	for(i = 0; i < count; i++) {
+		rgba[i*4 + 0] = data[i*3 + 0];
+		rgba[i*4 + 1] = data[i*3 + 1];
+		rgba[i*4 + 2] = data[i*3 + 2];
+		rgba[i*4 + 3] = 255;
+	}
+	free(data);
+	return rgba;
+
+}
+
+static int pack(struct sprite *sprites, int count, int size, int padding) {
+
+	int i, page, shelf_x, shelf_y, shelf_h, w, h;
+
+	page = 0;
+	shelf_x = 0;
+	shelf_y = 0;
+	shelf_h = 0;
+
+	for(i = 0; i < count; i++) {
+
+		w = sprites[i].width + padding * 2;
+		h = sprites[i].height + padding * 2;
+		if(w > size || h > size) {
+			fprintf(stderr, "%s (%dx%d) does not fit a %dx%d page\n",
+				sprites[i].name, sprites[i].width, sprites[i].height, size, size);
+			return -1;
+		}
+
+		if(shelf_x + w > size) {
+			shelf_y += shelf_h;
+			shelf_x = 0;
+			shelf_h = 0;
+		}
+
+		if(shelf_y + h > size) {
+			page++;
+			shelf_x = 0;
+			shelf_y = 0;
+			shelf_h = 0;
+		}
+
+		sprites[i].page = page;
+		sprites[i].x = shelf_x + padding;
+		sprites[i].y = shelf_y + padding;
+
+		shelf_x += w;
+		if(h > shelf_h) {
+			shelf_h = h;
+		}
+
+	}
+
+	return page + 1;
+
+}
+
+static void blit(unsigned char *page, int size, struct sprite *s, int padding) {
+
+	int x, y, sx, sy;
+
+	for(y = -padding; y < s->height + padding; y++) {
+		sy = y < 0 ? 0 : y >= s->height ? s->height - 1 : y;
+		for(x = -padding; x < s->width + padding; x++) {
+			sx = x < 0 ? 0 : x >= s->width ? s->width - 1 : x;
+			memcpy(
+				&page[((s->y + y) * size + s->x + x) * 4],
+				&s->pixels[(sy * s->width + sx) * 4],
+				4
+			);
+		}
+	}
+
+}
+
+static int write_png(const char *filename, unsigned char *pixels, int size) {
+
+	FILE *fp;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	int y;
+
+	fp = fopen(filename, "wb");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for writing\n", filename);
+		return -1;
+	}
+
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	info_ptr = png_create_info_struct(png_ptr);
+	if(setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		fclose(fp);
+		return -1;
+	}
+
+	png_init_io(png_ptr, fp);
+	png_set_IHDR(png_ptr, info_ptr, size, size, 8, PNG_COLOR_TYPE_RGBA,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	for(y = 0; y < size; y++) {
+		png_write_row(png_ptr, pixels + (size_t)y * size * 4);
+	}
+	png_write_end(png_ptr, NULL);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	fclose(fp);
+	return 0;
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct sprite *sprites;
+	const char *prefix, *base;
+	unsigned char *pixels;
+	char filename[4096];
+	int opt, size, padding, count, pages, i, p;
+	FILE *meta;
+
+	size = 1024;
+	padding = 2;
+	prefix = NULL;
+
+	while((opt = getopt(argc, argv, "s:p:o:")) != -1) {
+		switch(opt) {
+			case 's':
+				size = atoi(optarg);
+			break;
+			case 'p':
+				padding = atoi(optarg);
+			break;
+			case 'o':
+				prefix = optarg;
+			break;
+			default:
+				prefix = NULL;
+				optind = argc;
+			break;
+		}
+	}
+
+	count = argc - optind;
+	if(prefix == NULL || count < 1 || size < 1 || padding < 0) {
+		fprintf(stderr, "Usage: %s [-s page_size] [-p padding] -o <prefix> <file.png>...\n", argv[0]);
+		return 1;
+	}
+
+	sprites = (struct sprite*)calloc(count, sizeof(struct sprite));
+	for(i = 0; i < count; i++) {
+		sprite_name(argv[optind + i], sprites[i].name, sizeof(sprites[i].name));
+		sprites[i].pixels = load_rgba(argv[optind + i], &sprites[i].width, &sprites[i].height);
+		if(sprites[i].pixels == NULL) {
+			return 1;
+		}
+	}
+
+	qsort(sprites, count, sizeof(struct sprite), compare_height);
+	pages = pack(sprites, count, size, padding);
+	if(pages < 0) {
+		return 1;
+	}
+
+	// Page file names are written without the directory so the atlas
+	// can be moved or embedded together with its pages
+
+	base = strrchr(prefix, '/');
+	base = base ? base + 1 : prefix;
+
+	pixels = (unsigned char*)malloc((size_t)size * size * 4);
+	for(p = 0; p < pages; p++) {
+		memset(pixels, 0, (size_t)size * size * 4);
+		for(i = 0; i < count; i++) {
+			if(sprites[i].page == p) {
+				blit(pixels, size, &sprites[i], padding);
+			}
+		}
+		snprintf(filename, sizeof(filename), "%s_%d.png", prefix, p);
+		if(write_png(filename, pixels, size) != 0) {
+			return 1;
+		}
+	}
+	free(pixels);
+
+	snprintf(filename, sizeof(filename), "%s.atlas", prefix);
+	meta = fopen(filename, "w");
+	if(!meta) {
+		fprintf(stderr, "Could not open %s for writing\n", filename);
+		return 1;
+	}
+
+	qsort(sprites, count, sizeof(struct sprite), compare_name);
+	fprintf(meta, "dashgl-atlas 1\n");
+	for(p = 0; p < pages; p++) {
+		fprintf(meta, "page %d %s_%d.png %d %d\n", p, base, p, size, size);
+	}
+	for(i = 0; i < count; i++) {
+		fprintf(meta, "sprite %s %d %d %d %d %d\n", sprites[i].name, sprites[i].page,
+			sprites[i].x, sprites[i].y, sprites[i].width, sprites[i].height);
+		free(sprites[i].pixels);
+	}
+	fclose(meta);
+	free(sprites);
+
+	printf("Packed %d images into %d page(s) of %dx%d\n", count, pages, size, size);
+	return 0;
+
+}
@@ -0,0 +1,130 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Usage: embed <output.c> <file>...
+ *
+ * Writes a C source file holding every input file as a read only byte
+ * array, plus the dash_assets table that lib/dashgl searches by name.
+ * Entries are sorted by path so the table can be binary searched. Each
+ * array carries a trailing NUL that is not counted in its size, which
+ * lets text assets such as shaders be used as strings in place.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int compare_names(const void *a, const void *b) {
+
+	return strcmp(*(const char**)a, *(const char**)b);
+
+}
+
+static int embed_file(FILE *out, const char *filename, int index) {
+
+	FILE *fp;
+	int c, column;
+	long size;
+
+	fp = fopen(filename, "rb");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return -1;
+	}
+
+	fprintf(out, "/* %s */\n", filename);
+	fprintf(out, "static const unsigned char asset_%d[] = {\n\t", index);
+
+	size = 0;
+	column = 0;
+	while((c = fgetc(fp)) != EOF) {
+		fprintf(out, "0x%02x,", c);
+		size++;
+		if(++column == 16) {
+			fprintf(out, "\n\t");
+			column = 0;
+		}
+	}
+	fprintf(out, "0x00\n};\n\n");
+
+	fclose(fp);
+	return 0;
+
+}
+
+static long file_size(const char *filename) {
+
+	FILE *fp;
+	long size;
+
+	fp = fopen(filename, "rb");
+	if(!fp) {
+		return -1;
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fclose(fp);
+	return size;
+
+}
+
+int main(int argc, char *argv[]) {
+
+	FILE *out;
+	char **names;
+	int i, count;
+
+	if(argc < 2) {
+		fprintf(stderr, "Usage: %s <output.c> <file>...\n", argv[0]);
+		return 1;
+	}
+
+	count = argc - 2;
+	names = argv + 2;
+	qsort(names, count, sizeof(char*), compare_names);
+
+	out = fopen(argv[1], "w");
+	if(!out) {
+		fprintf(stderr, "Could not open %s for writing\n", argv[1]);
+		return 1;
+	}
+
+	fprintf(out, "/* Generated by tools/embed, do not edit */\n\n");
+	fprintf(out, "#include <stdio.h>\n");
+	fprintf(out, "#include <GL/glew.h>\n");
+	fprintf(out, "#include \"dashgl.h\"\n\n");
+
+	for(i = 0; i < count; i++) {
+		if(embed_file(out, names[i], i) != 0) {
+			fclose(out);
+			remove(argv[1]);
+			return 1;
+		}
+	}
+
+	fprintf(out, "const struct dash_asset dash_assets[] = {\n");
+	for(i = 0; i < count; i++) {
+		fprintf(out, "\t{ \"%s\", asset_%d, %ld },\n", names[i], i, file_size(names[i]));
+	}
+	fprintf(out, "\t{ NULL, NULL, 0 }\n};\n\n");
+	fprintf(out, "const int dash_asset_count = %d;\n", count);
+
+	fclose(out);
+	return 0;
+
+}
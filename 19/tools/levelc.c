@@ -0,0 +1,257 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Usage: levelc <input.txt> <output.lvl>
+ *        levelc -g <classic|COLSxROWS> <output.lvl>
+ *
+ * Converts a text level into the .lvl file mapped by level_map, or with
+ * -g bakes one of the generated levels. The text format is one setting
+ * per line, then the layout with one character per brick:
+ *
+ *     grid 5 6              columns and rows
+ *     pitch 127 30          distance between brick centres
+ *     size 122 28           brick width and height
+ *     origin 66 464         centre of the top left brick
+ *     color 0 1.0 0.0 0.0   palette index and rgb
+ *     type 3 4 cracks       type index, hit points, solid and/or cracks
+ *     brick a 0 0 1         character, type, palette index, hit points
+ *     layout
+ *     aaaaa
+ *     ...
+ *
+ * A '.' in the layout leaves the cell empty. Types that are not given
+ * keep the defaults of level_create.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+#include "../level.h"
+
+struct brick_kind {
+	int defined;
+	int type;
+	int color;
+	int hp;
+};
+
+static struct level *parse_level(const char *filename) {
+
+	FILE *fp;
+	struct level *level;
+	struct brick_kind kinds[256];
+	struct level_brick_type types[LEVEL_NUM_TYPES];
+	unsigned char defined_types[LEVEL_NUM_TYPES];
+	char line[4096], word[64], *rest, c;
+	int cols, rows, row, col, number, index, type, color, hp, n;
+	float pitch_x, pitch_y, width, height, origin_x, origin_y, r, g, b;
+	vec3 palette[LEVEL_PALETTE_SIZE];
+	int num_colors;
+
+	fp = fopen(filename, "r");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return NULL;
+	}
+
+	memset(kinds, 0, sizeof(kinds));
+	memset(palette, 0, sizeof(palette));
+	memset(defined_types, 0, sizeof(defined_types));
+	cols = rows = 0;
+	pitch_x = pitch_y = width = height = origin_x = origin_y = 0.0f;
+	num_colors = 0;
+	level = NULL;
+	number = 0;
+
+	while(fgets(line, sizeof(line), fp)) {
+
+		number++;
+		if(line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+
+		if(strncmp(line, "layout", 6) == 0) {
+			break;
+		}
+
+		if(
+			sscanf(line, "grid %d %d", &cols, &rows) == 2 ||
+			sscanf(line, "pitch %f %f", &pitch_x, &pitch_y) == 2 ||
+			sscanf(line, "size %f %f", &width, &height) == 2 ||
+			sscanf(line, "origin %f %f", &origin_x, &origin_y) == 2
+		) {
+			continue;
+		}
+
+		if(sscanf(line, "color %d %f %f %f", &index, &r, &g, &b) == 4) {
+			if(index < 0 || index >= LEVEL_PALETTE_SIZE) {
+				fprintf(stderr, "%s:%d: color index %d out of range\n", filename, number, index);
+				goto fail;
+			}
+			palette[index][0] = r;
+			palette[index][1] = g;
+			palette[index][2] = b;
+			if(index >= num_colors) {
+				num_colors = index + 1;
+			}
+			continue;
+		}
+
+		if(sscanf(line, "type %d %d%n", &index, &hp, &n) == 2) {
+			if(index < 0 || index >= LEVEL_NUM_TYPES || hp < 1 || hp > 255) {
+				fprintf(stderr, "%s:%d: type %d out of range\n", filename, number, index);
+				goto fail;
+			}
+			types[index].hp = hp;
+			types[index].flags = 0;
+			for(rest = line + n; sscanf(rest, "%63s%n", word, &n) == 1; rest += n) {
+				if(strcmp(word, "solid") == 0) {
+					types[index].flags |= LEVEL_TYPE_SOLID;
+				} else if(strcmp(word, "cracks") == 0) {
+					types[index].flags |= LEVEL_TYPE_CRACKS;
+				} else {
+					fprintf(stderr, "%s:%d: unknown type flag %s\n", filename, number, word);
+					goto fail;
+				}
+			}
+			defined_types[index] = 1;
+			continue;
+		}
+
+		if(sscanf(line, "brick %c %d %d %d", &c, &type, &color, &hp) == 4) {
+			if(type < 0 || type > 255 || color < 0 || color >= LEVEL_PALETTE_SIZE || hp < 1 || hp > 255) {
+				fprintf(stderr, "%s:%d: brick %c out of range\n", filename, number, c);
+				goto fail;
+			}
+			kinds[(unsigned char)c].defined = 1;
+			kinds[(unsigned char)c].type = type;
+			kinds[(unsigned char)c].color = color;
+			kinds[(unsigned char)c].hp = hp;
+			continue;
+		}
+
+		fprintf(stderr, "%s:%d: could not parse %s", filename, number, line);
+		goto fail;
+
+	}
+
+	if(cols < 1 || rows < 1 || pitch_x <= 0.0f || pitch_y <= 0.0f) {
+		fprintf(stderr, "%s: grid and pitch are required\n", filename);
+		goto fail;
+	}
+
+	level = level_create(cols, rows);
+	level->pitch_x = pitch_x;
+	level->pitch_y = pitch_y;
+	level->half_width = width / 2.0f;
+	level->half_height = height / 2.0f;
+	level->origin_x = origin_x;
+	level->origin_y = origin_y;
+	if(num_colors > 0) {
+		level->num_colors = num_colors;
+		memcpy(level->palette, palette, sizeof(palette));
+	}
+	for(index = 0; index < LEVEL_NUM_TYPES; index++) {
+		if(defined_types[index]) {
+			level->types[index] = types[index];
+		}
+	}
+
+	for(row = 0; row < rows; row++) {
+
+		number++;
+		if(!fgets(line, sizeof(line), fp)) {
+			fprintf(stderr, "%s: layout has %d of %d rows\n", filename, row, rows);
+			goto fail;
+		}
+
+		for(col = 0; col < cols; col++) {
+
+			index = row * cols + col;
+			c = col < (int)strlen(line) ? line[col] : '.';
+			if(c == '\n') {
+				c = '.';
+			}
+
+			if(c == '.') {
+				level->type[index] = 0;
+				level->hp[index] = 0;
+				level->color[index] = 0;
+				level->active[index] = 0;
+				continue;
+			}
+
+			if(!kinds[(unsigned char)c].defined) {
+				fprintf(stderr, "%s:%d: no brick defined for '%c'\n", filename, number, c);
+				goto fail;
+			}
+
+			level->type[index] = kinds[(unsigned char)c].type;
+			level->hp[index] = kinds[(unsigned char)c].hp;
+			level->color[index] = kinds[(unsigned char)c].color;
+			level->active[index] = 1;
+
+		}
+
+	}
+
+	level->remaining = level_count_breakable(level);
+
+	fclose(fp);
+	return level;
+
+fail:
+	fclose(fp);
+	level_free(level);
+	return NULL;
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct level *level;
+	const char *output;
+
+	if(argc == 4 && strcmp(argv[1], "-g") == 0) {
+		level = level_from_spec(argv[2], 640.0f, 480.0f);
+		output = argv[3];
+	} else if(argc == 3) {
+		level = parse_level(argv[1]);
+		output = argv[2];
+	} else {
+		fprintf(stderr, "Usage: %s <input.txt> <output.lvl>\n", argv[0]);
+		fprintf(stderr, "       %s -g <classic|COLSxROWS> <output.lvl>\n", argv[0]);
+		return 1;
+	}
+
+	if(level == NULL) {
+		return 1;
+	}
+
+	if(level_save(level, output) != 0) {
+		level_free(level);
+		return 1;
+	}
+
+	printf("%s: %dx%d, %d brick(s)\n", output, level->cols, level->rows, level->remaining);
+	level_free(level);
+	return 0;
+
+}
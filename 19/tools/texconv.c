@@ -0,0 +1,149 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Usage: texconv [-n] <input.png> <output.dtx>
+ *
+ * Converts a PNG into the .dtx container read by dash_texture_load_dtx:
+ * the dash_dtx_header from lib/dashgl.h followed by the full mip chain,
+ * each level starting on a 16 byte boundary. Levels are made with a
+ * 2x2 box filter down to 1x1; -n stores only the base level.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#include "../lib/dashgl.h"
+
+#define ALIGN(x) (((x) + 15) & ~15u)
+
+static unsigned char *downsample(const unsigned char *src, int width, int height, int channels, int *out_w, int *out_h) {
+
+	unsigned char *dst;
+	int w, h, x, y, c, x0, x1, y0, y1, sum;
+
+	w = width > 1 ? width / 2 : 1;
+	h = height > 1 ? height / 2 : 1;
+	dst = (unsigned char*)malloc(w * h * channels);
+
+	for(y = 0; y < h; y++) {
+		y0 = y * 2 < height ? y * 2 : height - 1;
+		y1 = y * 2 + 1 < height ? y * 2 + 1 : y0;
+		for(x = 0; x < w; x++) {
+			x0 = x * 2 < width ? x * 2 : width - 1;
+			x1 = x * 2 + 1 < width ? x * 2 + 1 : x0;
+			for(c = 0; c < channels; c++) {
+				sum = src[(y0 * width + x0) * channels + c];
+				sum += src[(y0 * width + x1) * channels + c];
+				sum += src[(y1 * width + x0) * channels + c];
+				sum += src[(y1 * width + x1) * channels + c];
+				dst[(y * w + x) * channels + c] = (sum + 2) / 4;
+			}
+		}
+	}
+
+	*out_w = w;
+	*out_h = h;
+	return dst;
+
+}
+
+int main(int argc, char *argv[]) {
+
+	struct dash_dtx_header header;
+	unsigned char *levels[DASH_DTX_MAX_LEVELS];
+	unsigned char padding[16];
+	const char *input, *output;
+	int width, height, channels, mipmaps, i, w, h;
+	unsigned int offset;
+	GLenum format;
+	FILE *fp;
+
+	mipmaps = 1;
+	if(argc == 4 && strcmp(argv[1], "-n") == 0) {
+		mipmaps = 0;
+		input = argv[2];
+		output = argv[3];
+	} else if(argc == 3) {
+		input = argv[1];
+		output = argv[2];
+	} else {
+		fprintf(stderr, "Usage: %s [-n] <input.png> <output.dtx>\n", argv[0]);
+		return 1;
+	}
+
+	levels[0] = dash_png_read(input, &width, &height, &format);
+	if(levels[0] == NULL) {
+		return 1;
+	}
+	channels = format == GL_RGBA ? 4 : 3;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = DASH_DTX_MAGIC;
+	header.format = format;
+	header.width = width;
+	header.height = height;
+
+	offset = ALIGN(sizeof(header));
+	w = width;
+	h = height;
+
+	for(i = 0; i < DASH_DTX_MAX_LEVELS; i++) {
+
+		if(i > 0) {
+			levels[i] = downsample(levels[i - 1], w, h, channels, &w, &h);
+		}
+
+		header.level[i].offset = offset;
+		header.level[i].size = w * h * channels;
+		header.level[i].width = w;
+		header.level[i].height = h;
+		header.num_levels = i + 1;
+		offset = ALIGN(offset + header.level[i].size);
+
+		if(!mipmaps || (w == 1 && h == 1)) {
+			break;
+		}
+
+	}
+
+	fp = fopen(output, "wb");
+	if(!fp) {
+		fprintf(stderr, "Could not open %s for writing\n", output);
+		return 1;
+	}
+
+	memset(padding, 0, sizeof(padding));
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite(padding, ALIGN(sizeof(header)) - sizeof(header), 1, fp);
+
+	for(i = 0; i < (int)header.num_levels; i++) {
+		fwrite(levels[i], header.level[i].size, 1, fp);
+		fwrite(padding, ALIGN(header.level[i].size) - header.level[i].size, 1, fp);
+		free(levels[i]);
+	}
+
+	if(fclose(fp) != 0) {
+		fprintf(stderr, "Could not write %s\n", output);
+		return 1;
+	}
+
+	printf("%s: %dx%d, %d level(s), %u bytes\n", output, width, height, header.num_levels, offset);
+	return 0;
+
+}
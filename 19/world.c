@@ -0,0 +1,696 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <GL/glew.h>
+#include "lib/dashgl.h"
+#include "level.h"
+#include "world.h"
+
+/******************************************************************************/
+/** Chunk Loading                                                            **/
+/******************************************************************************/
+
+static unsigned int world_hash(unsigned int seed, int row, int col) {
+
+	unsigned int h;
+
+	h = seed ^ (row * 0x9E3779B1u) ^ (col * 0x85EBCA77u);
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	return h;
+
+}
+
+static struct level *world_load_chunk(struct world *world, int index) {
+
+	struct level *level;
+	unsigned char *planes[4];
+	unsigned int h;
+	int first_row, rows, row, col, i, p;
+
+	DASH_ZONE("world_load_chunk");
+
+	first_row = index * WORLD_CHUNK_ROWS;
+	rows = world->rows - first_row;
+	if(rows > WORLD_CHUNK_ROWS) {
+		rows = WORLD_CHUNK_ROWS;
+	}
+
+	level = level_create(world->cols, rows);
+	level->origin_x = world->origin_x;
+	level->origin_y = world->origin_y - first_row * world->pitch_y;
+	level->pitch_x = world->pitch_x;
+	level->pitch_y = world->pitch_y;
+	level->half_width = world->half_width;
+	level->half_height = world->half_height;
+
+	if(world->fd != -1) {
+
+		// Each plane of the .lvl file holds the chunk's rows back to back
+		level->num_colors = world->num_colors;
+		memcpy(level->palette, world->palette, sizeof(world->palette));
+		memcpy(level->types, world->types, sizeof(world->types));
+		planes[0] = level->type;
+		planes[1] = level->hp;
+		planes[2] = level->color;
+		planes[3] = level->active;
+
+		for(p = 0; p < 4; p++) {
+			if(pread(world->fd, planes[p], level->count,
+				world->plane_offset[p] + (off_t)first_row * world->cols) != level->count) {
+				fprintf(stderr, "Could not read chunk %d\n", index);
+				memset(level->active, 0, level->count);
+				break;
+			}
+		}
+
+	} else {
+
+		// Generated worlds have a few holes, the odd cracking two hit
+		// brick and a few solid ones, with the colors running in bands
+		for(row = 0; row < rows; row++) {
+			for(col = 0; col < world->cols; col++) {
+				i = row * world->cols + col;
+				h = world_hash(world->seed, first_row + row, col);
+				level->active[i] = h % 8 != 0;
+				level->type[i] = h % 16 == 1 ? 1 : h % 64 == 2 ? 2 : 0;
+				level->hp[i] = level->types[level->type[i]].hp;
+				level->color[i] = (first_row + row) / 4 % level->num_colors;
+			}
+		}
+
+	}
+
+	level->remaining = level_count_breakable(level);
+
+	return level;
+
+}
+
+static void *world_loader(void *arg) {
+
+	struct world *world;
+	struct world_chunk *chunk;
+	struct level *level;
+
+	world = (struct world*)arg;
+	dash_profile_thread_name("world loader");
+
+	pthread_mutex_lock(&world->lock);
+	for(;;) {
+
+		while(world->running && world->queue == NULL) {
+			pthread_cond_wait(&world->wake_loader, &world->lock);
+		}
+		if(!world->running) {
+			break;
+		}
+
+		chunk = world->queue;
+		world->queue = chunk->next;
+		if(world->queue == NULL) {
+			world->queue_tail = NULL;
+		}
+		pthread_mutex_unlock(&world->lock);
+
+		level = world_load_chunk(world, chunk->index);
+
+		pthread_mutex_lock(&world->lock);
+		chunk->level = level;
+		chunk->host_bytes = sizeof(struct level) + LEVEL_PALETTE_SIZE * sizeof(vec3) +
+			LEVEL_NUM_TYPES * sizeof(struct level_brick_type) + level->count * 4;
+		chunk->state = WORLD_CHUNK_LOADED;
+		world->memory_used += chunk->host_bytes;
+		if(world->memory_used > world->memory_peak) {
+			world->memory_peak = world->memory_used;
+		}
+		world->loads++;
+		if(world->memory_used > world->memory_cap) {
+			pthread_cond_signal(&world->wake_evictor);
+		}
+
+	}
+	pthread_mutex_unlock(&world->lock);
+
+	return NULL;
+
+}
+
+/******************************************************************************/
+/** Eviction                                                                 **/
+/******************************************************************************/
+
+static struct world_chunk *world_pick_victim(struct world *world) {
+
+	struct world_chunk *victim;
+	int i, distance, best;
+
+	// The loaded chunk furthest from the chunks around the view
+	victim = NULL;
+	best = 0;
+	for(i = 0; i < world->num_chunks; i++) {
+
+		if(world->chunks[i].state != WORLD_CHUNK_LOADED) {
+			continue;
+		}
+
+		if(i < world->first_wanted) {
+			distance = world->first_wanted - i;
+		} else if(i > world->last_wanted) {
+			distance = i - world->last_wanted;
+		} else {
+			continue;
+		}
+
+		if(distance > best) {
+			best = distance;
+			victim = &world->chunks[i];
+		}
+
+	}
+
+	return victim;
+
+}
+
+static void *world_evictor(void *arg) {
+
+	struct world *world;
+	struct world_chunk *chunk;
+	struct level *level;
+	int idle;
+
+	world = (struct world*)arg;
+	dash_profile_thread_name("world evictor");
+
+	// After a pass that found nothing outside the window to take, wait
+	// for the window to move instead of looking again straight away
+	idle = 0;
+	pthread_mutex_lock(&world->lock);
+	for(;;) {
+
+		while(world->running && (idle || world->memory_used <= world->memory_cap)) {
+			pthread_cond_wait(&world->wake_evictor, &world->lock);
+			idle = 0;
+		}
+		if(!world->running) {
+			break;
+		}
+
+		while(world->memory_used > world->memory_cap) {
+
+			chunk = world_pick_victim(world);
+			if(chunk == NULL) {
+				idle = 1;
+				break;
+			}
+
+			// The host copy goes now, a buffer on the GPU has to be
+			// deleted on the GL thread by world_update
+			level = chunk->level;
+			chunk->level = NULL;
+			world->memory_used -= chunk->host_bytes;
+			chunk->host_bytes = 0;
+			world->evictions++;
+
+			if(chunk->vbo) {
+				chunk->state = WORLD_CHUNK_EVICTED;
+				chunk->next = world->released;
+				world->released = chunk;
+			} else {
+				chunk->state = WORLD_CHUNK_EMPTY;
+			}
+
+			pthread_mutex_unlock(&world->lock);
+			level_free(level);
+			pthread_mutex_lock(&world->lock);
+
+		}
+
+	}
+	pthread_mutex_unlock(&world->lock);
+
+	return NULL;
+
+}
+
+/******************************************************************************/
+/** World                                                                    **/
+/******************************************************************************/
+
+static int world_open_file(struct world *world, const char *filename) {
+
+	struct level_file_header header;
+	struct stat st;
+	long count;
+
+	world->fd = open(filename, O_RDONLY);
+	if(world->fd == -1) {
+		fprintf(stderr, "Could not open %s for reading\n", filename);
+		return -1;
+	}
+
+	if(
+		fstat(world->fd, &st) != 0 ||
+		pread(world->fd, &header, sizeof(header), 0) != sizeof(header) ||
+		header.magic != LEVEL_MAGIC ||
+		header.version != LEVEL_VERSION ||
+		header.cols < 1 || header.rows < 1 ||
+		header.pitch_y <= 0.0f
+	) {
+		fprintf(stderr, "%s is not a valid level file\n", filename);
+		return -1;
+	}
+
+	count = (long)header.cols * header.rows;
+	if(
+		header.palette_offset + LEVEL_PALETTE_SIZE * sizeof(vec3) > st.st_size ||
+		header.types_offset + sizeof(world->types) > st.st_size ||
+		header.type_offset + count > st.st_size ||
+		header.hp_offset + count > st.st_size ||
+		header.color_offset + count > st.st_size ||
+		header.active_offset + count > st.st_size ||
+		pread(world->fd, world->palette, sizeof(world->palette), header.palette_offset) != sizeof(world->palette) ||
+		pread(world->fd, world->types, sizeof(world->types), header.types_offset) != sizeof(world->types)
+	) {
+		fprintf(stderr, "%s is not a valid level file\n", filename);
+		return -1;
+	}
+
+	world->cols = header.cols;
+	world->rows = header.rows;
+	world->origin_x = header.origin_x;
+	world->origin_y = header.origin_y;
+	world->pitch_x = header.pitch_x;
+	world->pitch_y = header.pitch_y;
+	world->half_width = header.half_width;
+	world->half_height = header.half_height;
+	world->num_colors = header.num_colors;
+	world->plane_offset[0] = header.type_offset;
+	world->plane_offset[1] = header.hp_offset;
+	world->plane_offset[2] = header.color_offset;
+	world->plane_offset[3] = header.active_offset;
+	return 0;
+
+}
+
+struct world *world_open(const char *spec, float width, float height, long memory_cap) {
+
+	struct world *world;
+	float last_row;
+	int i;
+
+	world = (struct world*)calloc(1, sizeof(struct world));
+	world->fd = -1;
+
+	// A .lvl file is read a chunk at a time, COLSxROWS generates one
+	if(strlen(spec) > 4 && strcmp(spec + strlen(spec) - 4, ".lvl") == 0) {
+		if(world_open_file(world, spec) != 0) {
+			world_close(world);
+			return NULL;
+		}
+	} else if(sscanf(spec, "%dx%d", &world->cols, &world->rows) == 2 && world->cols > 0 && world->rows > 0) {
+		world->pitch_x = width / world->cols;
+		world->pitch_y = 15.0f;
+		world->half_width = world->pitch_x * 0.45f;
+		world->half_height = world->pitch_y * 0.45f;
+		world->origin_x = world->pitch_x * 0.5f;
+		world->origin_y = height - world->pitch_y * 0.5f;
+		world->seed = 1;
+	} else {
+		fprintf(stderr, "Could not parse world %s, expected a .lvl file or COLSxROWS\n", spec);
+		free(world);
+		return NULL;
+	}
+
+	world->num_chunks = (world->rows + WORLD_CHUNK_ROWS - 1) / WORLD_CHUNK_ROWS;
+	world->chunks = (struct world_chunk*)calloc(world->num_chunks, sizeof(struct world_chunk));
+	for(i = 0; i < world->num_chunks; i++) {
+		world->chunks[i].index = i;
+	}
+
+	// Screen y is world y minus the camera. The last row starts half way
+	// up the screen and scrolling stops once row 0 reaches the top.
+	last_row = world->origin_y - (world->rows - 1) * world->pitch_y;
+	world->view_height = height;
+	world->camera_max = world->origin_y + world->pitch_y * 0.5f - height;
+	world->camera_min = last_row - height * 0.5f;
+	if(world->camera_min > world->camera_max) {
+		world->camera_min = world->camera_max;
+	}
+	world->camera = world->camera_min;
+	world->scroll = 0.25f;
+	world->prefetch = 2;
+	world->first_wanted = -1;
+	world->last_wanted = -1;
+	world->memory_cap = memory_cap;
+
+	pthread_mutex_init(&world->lock, NULL);
+	pthread_cond_init(&world->wake_loader, NULL);
+	pthread_cond_init(&world->wake_evictor, NULL);
+	world->running = 1;
+
+	if(pthread_create(&world->loader, NULL, world_loader, world) != 0) {
+		fprintf(stderr, "Could not start world loader\n");
+		world->running = 0;
+		world_close(world);
+		return NULL;
+	}
+
+	if(pthread_create(&world->evictor, NULL, world_evictor, world) != 0) {
+		fprintf(stderr, "Could not start world evictor\n");
+		pthread_mutex_lock(&world->lock);
+		world->running = 0;
+		pthread_cond_broadcast(&world->wake_loader);
+		pthread_mutex_unlock(&world->lock);
+		pthread_join(world->loader, NULL);
+		world_close(world);
+		return NULL;
+	}
+
+	return world;
+
+}
+
+void world_close(struct world *world) {
+
+	struct world_chunk *chunk;
+	int i;
+
+	if(world == NULL) {
+		return;
+	}
+
+	if(world->running) {
+		pthread_mutex_lock(&world->lock);
+		world->running = 0;
+		pthread_cond_broadcast(&world->wake_loader);
+		pthread_cond_broadcast(&world->wake_evictor);
+		pthread_mutex_unlock(&world->lock);
+		pthread_join(world->loader, NULL);
+		pthread_join(world->evictor, NULL);
+	}
+
+	for(i = 0; i < world->num_chunks; i++) {
+		chunk = &world->chunks[i];
+		level_free(chunk->level);
+		if(chunk->vbo) {
+			dash_delete_buffer(chunk->vbo);
+		}
+	}
+
+	if(world->fd != -1) {
+		close(world->fd);
+	}
+	free(world->chunks);
+	free(world);
+
+}
+
+void world_advance(struct world *world) {
+
+	world->camera += world->scroll;
+	if(world->camera > world->camera_max) {
+		world->camera = world->camera_max;
+	}
+
+}
+
+static void world_visible_chunks(struct world *world, int *first, int *last) {
+
+	float top, bottom;
+
+	// Rows whose bricks reach into the screen, rows count downwards
+	top = (world->origin_y - (world->camera + world->view_height + world->half_height)) / world->pitch_y;
+	bottom = (world->origin_y - (world->camera - world->half_height)) / world->pitch_y;
+
+	*first = (int)floorf(top) / WORLD_CHUNK_ROWS;
+	*last = (int)ceilf(bottom) / WORLD_CHUNK_ROWS;
+
+	if(*first < 0) {
+		*first = 0;
+	}
+	if(*last >= world->num_chunks) {
+		*last = world->num_chunks - 1;
+	}
+
+}
+
+static void world_upload(struct world *world, struct world_chunk *chunk) {
+
+	struct level *level;
+	struct level_vertex *vertices;
+	long bytes;
+	int i, total;
+
+	DASH_ZONE("world_upload");
+
+	// Only the active bricks, in the same baked format as a level, so a
+	// chunk draws at once
+	level = chunk->ready;
+	total = 0;
+	for(i = 0; i < level->count; i++) {
+		total += level->active[i] != 0;
+	}
+	chunk->vertices = total * LEVEL_BRICK_VERTICES;
+
+	bytes = (long)chunk->vertices * sizeof(struct level_vertex);
+	vertices = (struct level_vertex*)malloc(bytes > 0 ? bytes : 1);
+	total = 0;
+	for(i = 0; i < level->count; i++) {
+		if(level->active[i]) {
+			level_brick_vertices(level, i, vertices + total * LEVEL_BRICK_VERTICES);
+			total++;
+		}
+	}
+
+	if(chunk->vbo == 0) {
+		chunk->vbo = dash_create_buffer(GL_ARRAY_BUFFER, bytes, vertices, GL_STATIC_DRAW, "world chunk");
+	} else {
+		dash_bind_buffer(GL_ARRAY_BUFFER, chunk->vbo);
+		glBufferData(GL_ARRAY_BUFFER, bytes, vertices, GL_STATIC_DRAW);
+		dash_resource_resize(DASH_RESOURCE_BUFFER, chunk->vbo, bytes);
+	}
+	free(vertices);
+
+	pthread_mutex_lock(&world->lock);
+	world->memory_used += bytes - chunk->gpu_bytes;
+	if(world->memory_used > world->memory_peak) {
+		world->memory_peak = world->memory_used;
+	}
+	pthread_mutex_unlock(&world->lock);
+	chunk->gpu_bytes = bytes;
+
+}
+
+int world_update(struct world *world, int max_uploads) {
+
+	struct world_chunk *released, *chunk;
+	int visible_first, visible_last, first, last, i, pending;
+
+	DASH_ZONE("world_update");
+
+	// Buffers of chunks the evictor took go first, on this thread
+
+	pthread_mutex_lock(&world->lock);
+	released = world->released;
+	world->released = NULL;
+	pthread_mutex_unlock(&world->lock);
+
+	for(chunk = released; chunk; chunk = chunk->next) {
+		dash_delete_buffer(chunk->vbo);
+		chunk->vbo = 0;
+	}
+
+	world_visible_chunks(world, &visible_first, &visible_last);
+	first = visible_first - world->prefetch;
+	last = visible_last + world->prefetch;
+	if(first < 0) {
+		first = 0;
+	}
+	if(last >= world->num_chunks) {
+		last = world->num_chunks - 1;
+	}
+
+	pthread_mutex_lock(&world->lock);
+
+	for(chunk = released; chunk; chunk = chunk->next) {
+		world->memory_used -= chunk->gpu_bytes;
+		chunk->gpu_bytes = 0;
+		chunk->state = WORLD_CHUNK_EMPTY;
+	}
+
+	// Chunks leaving the window stop being used before the evictor may
+	// take them, only this thread reads or writes usable and ready
+	for(i = world->first_wanted; i >= 0 && i <= world->last_wanted; i++) {
+		if(i < first || i > last) {
+			world->chunks[i].usable = 0;
+			world->chunks[i].ready = NULL;
+		}
+	}
+	world->first_wanted = first;
+	world->last_wanted = last;
+
+	// The loader sets state and level under the lock, what it has
+	// finished is taken here and then kept until the chunk leaves
+	for(i = first; i <= last; i++) {
+		chunk = &world->chunks[i];
+		if(chunk->state == WORLD_CHUNK_LOADED) {
+			chunk->ready = chunk->level;
+		} else if(chunk->state == WORLD_CHUNK_EMPTY) {
+			chunk->state = WORLD_CHUNK_QUEUED;
+			chunk->next = NULL;
+			if(world->queue_tail) {
+				world->queue_tail->next = chunk;
+			} else {
+				world->queue = chunk;
+			}
+			world->queue_tail = chunk;
+			pthread_cond_signal(&world->wake_loader);
+		}
+	}
+
+	if(world->memory_used > world->memory_cap) {
+		pthread_cond_signal(&world->wake_evictor);
+	}
+
+	pthread_mutex_unlock(&world->lock);
+
+	// Loaded chunks in the window are safe from the evictor, so their
+	// bricks are used through ready without the lock from here on
+
+	for(i = first; i <= last; i++) {
+
+		chunk = &world->chunks[i];
+		if(chunk->ready == NULL) {
+			continue;
+		}
+
+		if(chunk->usable && chunk->dirty) {
+			world_upload(world, chunk);
+			chunk->dirty = 0;
+		} else if(!chunk->usable && max_uploads > 0) {
+			world_upload(world, chunk);
+			chunk->usable = 1;
+			chunk->dirty = 0;
+			max_uploads--;
+		}
+
+	}
+
+	// On screen but not drawn yet, the prefetch margin should keep
+	// this at 0 once the first screen is in
+	pending = 0;
+	for(i = visible_first; i <= visible_last; i++) {
+		pending += !world->chunks[i].usable;
+	}
+
+	return pending;
+
+}
+
+int world_brick_at(struct world *world, float x, float y, struct world_chunk **chunk) {
+
+	int row;
+
+	y += world->camera;
+	row = (int)floorf((world->origin_y - y) / world->pitch_y + 0.5f);
+	if(row < 0 || row >= world->rows) {
+		return -1;
+	}
+
+	*chunk = &world->chunks[row / WORLD_CHUNK_ROWS];
+	if(!(*chunk)->usable) {
+		return -1;
+	}
+
+	return level_brick_at((*chunk)->ready, x, y);
+
+}
+
+int world_draw(struct world *world, GLint attribute_coord2d, GLint attribute_color, GLint uniform_mvp, GLint uniform_diffuse) {
+
+	struct world_chunk *chunk;
+	int first, last, i, draws;
+	vec3 offset, white;
+	mat4 mvp;
+
+	DASH_ZONE("world_draw");
+
+	offset[0] = 0.0f;
+	offset[1] = -world->camera;
+	offset[2] = 0.0f;
+	mat4_translate(offset, mvp);
+	dash_uniform_matrix4fv(uniform_mvp, mvp);
+	white[0] = white[1] = white[2] = 1.0f;
+	dash_uniform3fv(uniform_diffuse, white);
+	dash_enable_attrib(attribute_color);
+
+	// Chunks in the window but off screen are culled here, before any
+	// buffer is bound for them
+	world_visible_chunks(world, &first, &last);
+	world->culled = 0;
+	for(i = world->first_wanted; i >= 0 && i <= world->last_wanted; i++) {
+		if((i < first || i > last) && world->chunks[i].usable) {
+			world->culled++;
+		}
+	}
+
+	draws = 0;
+	world->drawn = 0;
+	for(i = first; i <= last; i++) {
+
+		chunk = &world->chunks[i];
+		if(!chunk->usable || chunk->vertices == 0) {
+			continue;
+		}
+
+		dash_bind_buffer(GL_ARRAY_BUFFER, chunk->vbo);
+		dash_attrib_pointer(attribute_coord2d, 2, GL_FLOAT, GL_FALSE,
+			sizeof(struct level_vertex), (void*)0);
+		dash_attrib_pointer(attribute_color, 3, GL_UNSIGNED_BYTE, GL_TRUE,
+			sizeof(struct level_vertex), (void*)(2 * sizeof(float)));
+		glDrawArrays(GL_TRIANGLES, 0, chunk->vertices);
+		world->drawn++;
+		draws++;
+
+	}
+	dash_disable_attrib(attribute_color);
+
+	return draws;
+
+}
+
+void world_print(struct world *world, FILE *fp) {
+
+	pthread_mutex_lock(&world->lock);
+	fprintf(fp, "World: %d chunks of %d rows, %lu loads, %lu evictions\n",
+		world->num_chunks, WORLD_CHUNK_ROWS, world->loads, world->evictions);
+	fprintf(fp, "  memory %.1f KiB, peak %.1f KiB, cap %.1f KiB\n",
+		world->memory_used / 1024.0, world->memory_peak / 1024.0, world->memory_cap / 1024.0);
+	pthread_mutex_unlock(&world->lock);
+
+}
@@ -0,0 +1,111 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BRICKOUT_WORLD
+#define BRICKOUT_WORLD
+
+	/**********************************************************************/
+	/** Scrolling Worlds                                                 **/
+	/**********************************************************************/
+
+	// A world is a level many screens tall, cut into chunks of
+	// WORLD_CHUNK_ROWS rows that each hold a small struct level placed in
+	// world coordinates. The camera starts on the last rows and scrolls
+	// up towards row 0, so the bricks come down towards the paddle.
+	//
+	// Only chunks near the camera are kept. world_update, called on the
+	// GL thread, queues the chunks around the view for a loader thread
+	// and uploads the ones that arrived. An evictor thread frees chunks
+	// away from the view whenever the memory cap is exceeded. Bricks that
+	// were knocked out come back if their chunk is evicted and loaded
+	// again, which only happens when the camera never returns to it.
+
+	#define WORLD_CHUNK_ROWS 32
+
+	enum {
+		WORLD_CHUNK_EMPTY,
+		WORLD_CHUNK_QUEUED,
+		WORLD_CHUNK_LOADED,
+		WORLD_CHUNK_EVICTED
+	};
+
+	struct world_chunk {
+		int index;
+		int state;
+		int usable;
+		int dirty;
+		struct level *level;
+		struct level *ready;
+		long host_bytes;
+		GLuint vbo;
+		long gpu_bytes;
+		int vertices;
+		struct world_chunk *next;
+	};
+
+	struct world {
+		int cols;
+		int rows;
+		int num_chunks;
+		float origin_x;
+		float origin_y;
+		float pitch_x;
+		float pitch_y;
+		float half_width;
+		float half_height;
+		int num_colors;
+		vec3 palette[LEVEL_PALETTE_SIZE];
+		struct level_brick_type types[LEVEL_NUM_TYPES];
+		int fd;
+		unsigned int plane_offset[4];
+		unsigned int seed;
+		float view_height;
+		float camera;
+		float camera_min;
+		float camera_max;
+		float scroll;
+		int prefetch;
+		int first_wanted;
+		int last_wanted;
+		long memory_cap;
+		long memory_used;
+		long memory_peak;
+		unsigned long loads;
+		unsigned long evictions;
+		int drawn;
+		int culled;
+		struct world_chunk *chunks;
+		struct world_chunk *queue;
+		struct world_chunk *queue_tail;
+		struct world_chunk *released;
+		int running;
+		pthread_t loader;
+		pthread_t evictor;
+		pthread_mutex_t lock;
+		pthread_cond_t wake_loader;
+		pthread_cond_t wake_evictor;
+	};
+
+	struct world *world_open(const char *spec, float width, float height, long memory_cap);
+	void world_close(struct world *world);
+	void world_advance(struct world *world);
+	int world_update(struct world *world, int max_uploads);
+	int world_brick_at(struct world *world, float x, float y, struct world_chunk **chunk);
+	int world_draw(struct world *world, GLint attribute_coord2d, GLint attribute_color, GLint uniform_mvp, GLint uniform_diffuse);
+	void world_print(struct world *world, FILE *fp);
+
+#endif
@@ -0,0 +1,367 @@
+/*
+ *  This file is part of DashGL.com - Gtk - Brickout Tutorial
+ *  Copyright (C) 2017 Benjamin Collins
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * LD_PRELOAD shim used by bench/steps.sh to measure an unmodified step.
+ *
+ * Handlers connected to a GtkGLArea "render" signal and callbacks added
+ * with g_timeout_add are wrapped, so the shim sees every frame and every
+ * simulation tick. glDrawArrays and glDrawElements are interposed to
+ * count draw calls and vertices; the instanced variants are caught when
+ * GLEW looks them up through glXGetProcAddress. Draws are queued
+ * continuously so steps without their own timer still produce frames.
+ *
+ * After DASH_BENCH_WARMUP frames (default 30) the next DASH_BENCH_FRAMES
+ * (default 300) are measured, one tab separated line is written to
+ * DASH_BENCH_OUT and the main loop is asked to quit:
+ *
+ *     frames  cpu_ms_avg  cpu_ms_max  fps  ticks_per_sec  draws_per_frame  vertices_per_frame
+ *
+ * A step that never connects a render handler writes a line of zeros
+ * five seconds after its first signal connection.
+ *
+ * glib and GL types are declared locally, the shim needs no headers and
+ * resolves everything at run time with dlsym.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef void *gpointer;
+typedef int gboolean;
+typedef unsigned int guint;
+typedef unsigned long gulong;
+typedef void (*GCallback)(void);
+typedef gboolean (*GSourceFunc)(gpointer data);
+typedef void (*GClosureNotify)(gpointer data, gpointer closure);
+typedef gboolean (*render_func)(gpointer area, gpointer context, gpointer data);
+
+typedef gulong (*connect_func)(gpointer, const char*, GCallback, gpointer, GClosureNotify, int);
+typedef guint (*timeout_func)(guint, GSourceFunc, gpointer);
+typedef void (*draw_arrays_func)(unsigned int, int, int);
+typedef void (*draw_elements_func)(unsigned int, int, unsigned int, const void*);
+typedef void (*draw_arrays_instanced_func)(unsigned int, int, int, int);
+typedef void (*draw_elements_instanced_func)(unsigned int, int, unsigned int, const void*, int);
+typedef void *(*proc_address_func)(const unsigned char*);
+
+struct wrapped {
+	GCallback func;
+	gpointer data;
+};
+
+struct {
+	connect_func connect;
+	timeout_func timeout;
+	draw_arrays_func draw_arrays;
+	draw_elements_func draw_elements;
+	draw_arrays_instanced_func draw_arrays_instanced;
+	draw_elements_instanced_func draw_elements_instanced;
+	int started;
+	int done;
+	int warmup;
+	int limit;
+	int frame;
+	int measuring;
+	gpointer area;
+	double start;
+	double cpu_ms;
+	double cpu_max;
+	unsigned long ticks;
+	unsigned long draws;
+	unsigned long vertices;
+} bench;
+
+static double bench_now_ms() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+
+}
+
+static void *bench_real(const char *name) {
+
+	void *func;
+
+	func = dlsym(RTLD_NEXT, name);
+	if(func == NULL) {
+		fprintf(stderr, "frameshim: could not resolve %s\n", name);
+		exit(3);
+	}
+	return func;
+
+}
+
+static int bench_env(const char *name, int fallback) {
+
+	const char *value;
+
+	value = getenv(name);
+	return value && atoi(value) > 0 ? atoi(value) : fallback;
+
+}
+
+static void bench_finish() {
+
+	const char *out;
+	void (*quit)(void);
+	double elapsed;
+	int frames;
+	FILE *fp;
+
+	if(bench.done) {
+		return;
+	}
+	bench.done = 1;
+
+	frames = bench.measuring ? bench.frame - bench.warmup : 0;
+	elapsed = frames ? (bench_now_ms() - bench.start) / 1000.0 : 0.0;
+
+	out = getenv("DASH_BENCH_OUT");
+	fp = out ? fopen(out, "w") : stdout;
+	if(fp) {
+		if(frames == 0 || elapsed <= 0.0) {
+			fprintf(fp, "0\t0\t0\t0\t0\t0\t0\n");
+		} else {
+			fprintf(fp, "%d\t%.4f\t%.4f\t%.1f\t%.1f\t%.2f\t%.1f\n", frames,
+				bench.cpu_ms / frames, bench.cpu_max, frames / elapsed,
+				bench.ticks / elapsed, (double)bench.draws / frames,
+				(double)bench.vertices / frames);
+		}
+		if(fp != stdout) {
+			fclose(fp);
+		}
+	}
+
+	quit = (void (*)(void))dlsym(RTLD_DEFAULT, "gtk_main_quit");
+	if(quit) {
+		quit();
+	} else {
+		exit(0);
+	}
+
+}
+
+static gboolean bench_drive(gpointer data) {
+
+	void (*queue_draw)(gpointer);
+
+	if(bench.done) {
+		return 0;
+	}
+
+	queue_draw = (void (*)(gpointer))dlsym(RTLD_DEFAULT, "gtk_widget_queue_draw");
+	if(bench.area && queue_draw) {
+		queue_draw(bench.area);
+	}
+	return 1;
+
+}
+
+static gboolean bench_watchdog(gpointer data) {
+
+	// No render handler after five seconds, nothing to measure
+	if(bench.area == NULL) {
+		bench_finish();
+	}
+	return 0;
+
+}
+
+static gboolean bench_render(gpointer area, gpointer context, gpointer data) {
+
+	struct wrapped *render = (struct wrapped*)data;
+	gboolean result;
+	double start, ms;
+
+	if(bench.done) {
+		return ((render_func)render->func)(area, context, render->data);
+	}
+
+	if(bench.frame == bench.warmup) {
+		bench.measuring = 1;
+		bench.start = bench_now_ms();
+	}
+
+	start = bench_now_ms();
+	result = ((render_func)render->func)(area, context, render->data);
+	ms = bench_now_ms() - start;
+
+	if(bench.measuring) {
+		bench.cpu_ms += ms;
+		if(ms > bench.cpu_max) {
+			bench.cpu_max = ms;
+		}
+	}
+
+	bench.frame++;
+	if(bench.frame >= bench.warmup + bench.limit) {
+		bench_finish();
+	}
+	return result;
+
+}
+
+static gboolean bench_tick(gpointer data) {
+
+	struct wrapped *tick = (struct wrapped*)data;
+
+	if(bench.measuring && !bench.done) {
+		bench.ticks++;
+	}
+	return ((GSourceFunc)tick->func)(tick->data);
+
+}
+
+static void bench_start() {
+
+	if(bench.started) {
+		return;
+	}
+	bench.started = 1;
+
+	bench.connect = (connect_func)bench_real("g_signal_connect_data");
+	bench.timeout = (timeout_func)bench_real("g_timeout_add");
+	bench.warmup = bench_env("DASH_BENCH_WARMUP", 30);
+	bench.limit = bench_env("DASH_BENCH_FRAMES", 300);
+
+	bench.timeout(5000, bench_watchdog, NULL);
+
+}
+
+gulong g_signal_connect_data(gpointer instance, const char *signal, GCallback handler, gpointer data, GClosureNotify destroy, int flags) {
+
+	struct wrapped *render;
+
+	bench_start();
+
+	if(strcmp(signal, "render") != 0) {
+		return bench.connect(instance, signal, handler, data, destroy, flags);
+	}
+
+	render = (struct wrapped*)malloc(sizeof(struct wrapped));
+	render->func = handler;
+	render->data = data;
+
+	if(bench.area == NULL) {
+		bench.area = instance;
+		bench.timeout(1, bench_drive, NULL);
+	}
+
+	// G_CONNECT_SWAPPED would pass data first, the steps never use it
+	return bench.connect(instance, signal, (GCallback)bench_render, render, destroy, flags);
+
+}
+
+guint g_timeout_add(guint interval, GSourceFunc function, gpointer data) {
+
+	struct wrapped *tick;
+
+	bench_start();
+
+	tick = (struct wrapped*)malloc(sizeof(struct wrapped));
+	tick->func = (GCallback)function;
+	tick->data = data;
+	return bench.timeout(interval, bench_tick, tick);
+
+}
+
+void glDrawArrays(unsigned int mode, int first, int count) {
+
+	if(bench.draw_arrays == NULL) {
+		bench.draw_arrays = (draw_arrays_func)bench_real("glDrawArrays");
+	}
+	if(bench.measuring && !bench.done) {
+		bench.draws++;
+		bench.vertices += count;
+	}
+	bench.draw_arrays(mode, first, count);
+
+}
+
+void glDrawElements(unsigned int mode, int count, unsigned int type, const void *indices) {
+
+	if(bench.draw_elements == NULL) {
+		bench.draw_elements = (draw_elements_func)bench_real("glDrawElements");
+	}
+	if(bench.measuring && !bench.done) {
+		bench.draws++;
+		bench.vertices += count;
+	}
+	bench.draw_elements(mode, count, type, indices);
+
+}
+
+static void bench_draw_arrays_instanced(unsigned int mode, int first, int count, int instances) {
+
+	if(bench.measuring && !bench.done) {
+		bench.draws++;
+		bench.vertices += (unsigned long)count * instances;
+	}
+	bench.draw_arrays_instanced(mode, first, count, instances);
+
+}
+
+static void bench_draw_elements_instanced(unsigned int mode, int count, unsigned int type, const void *indices, int instances) {
+
+	if(bench.measuring && !bench.done) {
+		bench.draws++;
+		bench.vertices += (unsigned long)count * instances;
+	}
+	bench.draw_elements_instanced(mode, count, type, indices, instances);
+
+}
+
+static void *bench_proc_address(const char *real, const unsigned char *name) {
+
+	proc_address_func lookup;
+	void *func;
+
+	lookup = (proc_address_func)bench_real(real);
+	func = lookup(name);
+	if(func == NULL) {
+		return NULL;
+	}
+
+	if(strcmp((const char*)name, "glDrawArraysInstanced") == 0) {
+		bench.draw_arrays_instanced = (draw_arrays_instanced_func)func;
+		return (void*)bench_draw_arrays_instanced;
+	}
+	if(strcmp((const char*)name, "glDrawElementsInstanced") == 0) {
+		bench.draw_elements_instanced = (draw_elements_instanced_func)func;
+		return (void*)bench_draw_elements_instanced;
+	}
+	return func;
+
+}
+
+void *glXGetProcAddressARB(const unsigned char *name) {
+
+	return bench_proc_address("glXGetProcAddressARB", name);
+
+}
+
+void *glXGetProcAddress(const unsigned char *name) {
+
+	return bench_proc_address("glXGetProcAddress", name);
+
+}
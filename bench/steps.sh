@@ -0,0 +1,144 @@
+#!/bin/sh
+#
+# Usage: bench/steps.sh [-f frames] [-t threshold] [-o results.tsv] [step...]
+#
+# Builds every tutorial step (00 to 19 unless steps are given) in a
+# scratch copy, runs it headless on a software GL context for a fixed
+# number of frames with bench/frameshim.so preloaded, and prints a table
+# of CPU time per frame, frames and simulation ticks per second, and
+# draw calls and vertices per frame.
+#
+# Each step is compared to the step before it. CPU time or draw calls
+# per frame growing by more than the threshold percent (default 25) is
+# reported as a REGRESSION and makes the script exit with 1, so the
+# step that introduced a cost can be found at a glance.
+#
+# Needs gcc, make, the gtk+-3.0 and GLEW development files, and either
+# a display or xvfb-run. The rows are also written as tab separated
+# values to bench/steps.tsv, or to the file given with -o.
+#
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+frames=300
+threshold=25
+out="$root/bench/steps.tsv"
+
+while getopts "f:t:o:" opt; do
+	case $opt in
+		f) frames=$OPTARG ;;
+		t) threshold=$OPTARG ;;
+		o) out=$OPTARG ;;
+		*) echo "Usage: $0 [-f frames] [-t threshold] [-o results.tsv] [step...]" >&2; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -gt 0 ]; then
+	steps="$*"
+else
+	steps=$(cd "$root" && ls -d [0-9][0-9])
+fi
+
+work=$(mktemp -d /tmp/dashgl_steps_XXXXXX)
+trap 'rm -rf "$work"' EXIT
+
+shim="$work/frameshim.so"
+if ! gcc -O2 -shared -fPIC -o "$shim" "$root/bench/frameshim.c" -ldl; then
+	echo "Could not build frameshim" >&2
+	exit 2
+fi
+
+if [ -z "$DISPLAY" ] && ! command -v xvfb-run >/dev/null; then
+	echo "No DISPLAY and no xvfb-run" >&2
+	exit 2
+fi
+
+headless() {
+
+	if [ -n "$DISPLAY" ]; then
+		"$@"
+	else
+		xvfb-run -a -s "-screen 0 1024x768x24" "$@"
+	fi
+
+}
+
+printf "# step\tframes\tcpu_ms_avg\tcpu_ms_max\tfps\tticks_per_sec\tdraws_per_frame\tvertices_per_frame\n" > "$out"
+
+for step in $steps; do
+
+	# Software GL keeps results comparable between machines, and the
+	# steps are built in a copy so the a.out files in the tree are left
+	# alone
+	cp -R "$root/$step" "$work/$step"
+
+	if ! make -C "$work/$step" > "$work/$step.log" 2>&1; then
+		echo "$step: build failed, see below" >&2
+		tail -5 "$work/$step.log" >&2
+		printf "%s\tbuild-failed\n" "$step" >> "$out"
+		continue
+	fi
+
+	result="$work/$step.tsv"
+	rm -f "$result"
+	(
+		cd "$work/$step" &&
+		headless timeout 120 env LD_PRELOAD="$shim" LIBGL_ALWAYS_SOFTWARE=1 \
+			DASH_BENCH_OUT="$result" DASH_BENCH_FRAMES="$frames" \
+			./a.out > /dev/null 2>&1
+	)
+
+	if [ -s "$result" ]; then
+		printf "%s\t%s\n" "$step" "$(cat "$result")" >> "$out"
+	else
+		printf "%s\ttimeout\n" "$step" >> "$out"
+	fi
+
+done
+
+awk -F '\t' -v threshold="$threshold" '
+	/^#/ { next }
+	BEGIN {
+		printf "%-5s %7s %10s %10s %8s %9s %8s %10s  %s\n",
+			"step", "frames", "cpu ms", "cpu max", "fps", "ticks/s", "draws", "vertices", "vs previous"
+	}
+	NF < 8 {
+		printf "%-5s %s\n", $1, $2
+		next
+	}
+	{
+		change = ""
+		if(have_prev && $2 > 0) {
+			if(prev_cpu > 0) {
+				cpu = ($3 - prev_cpu) / prev_cpu * 100
+				change = sprintf("cpu %+.1f%%", cpu)
+				if(cpu > threshold) {
+					alerts[++count] = sprintf("REGRESSION %s: cpu %.4f ms -> %.4f ms per frame (%+.1f%%) since %s", $1, prev_cpu, $3, cpu, prev_step)
+				}
+			}
+			if(prev_draws > 0) {
+				draws = ($7 - prev_draws) / prev_draws * 100
+				change = change sprintf(" draws %+.1f%%", draws)
+				if(draws > threshold) {
+					alerts[++count] = sprintf("REGRESSION %s: %.2f -> %.2f draw calls per frame (%+.1f%%) since %s", $1, prev_draws, $7, draws, prev_step)
+				}
+			}
+		}
+		printf "%-5s %7d %10.4f %10.4f %8.1f %9.1f %8.2f %10.1f  %s\n",
+			$1, $2, $3, $4, $5, $6, $7, $8, change
+		if($2 > 0) {
+			have_prev = 1
+			prev_step = $1
+			prev_cpu = $3
+			prev_draws = $7
+		}
+	}
+	END {
+		for(i = 1; i <= count; i++) {
+			print alerts[i] > "/dev/stderr"
+		}
+		if(count) {
+			exit 1
+		}
+	}
+' "$out"